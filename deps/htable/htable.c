@@ -10,21 +10,27 @@
 
 // -------- uint32_t-keyed hash table ----------------
 
-// Block size for resizing
-#define HTU32_BLK 32
+// (modified for the awm project: rewritten as a power-of-two robin hood table with backward-shift
+// deletion and geometric growth; the API is unchanged)
 
-// Hash table node
+// Initial capacity of a table (must be a power of two)
+#define HTU32_MIN_CAP 16
+
+// Maximum load factor before growing, as a fraction of capacity (3/4)
+#define HTU32_MAX_LOAD(cap) (((cap) >> 1) + ((cap) >> 2))
+
+// Hash table node (16 bytes on 64-bit: the key and probe distance share 8 bytes, the value takes 8)
 struct node_u32 {
-	void     *val;   // Value
-	uint32_t key;    // Key
-	uint8_t  is_occ; // Is this slot occupied?
+	uint32_t key;  // Key
+	uint32_t dist; // Distance from the node's home slot, plus one (0 if the slot is empty)
+	void     *val; // Value
 };
 
 // uint32_t-keyed hash table
 struct htable_u32 {
-	uint32_t        cap;    // Max capacity of table
+	uint32_t        mask;   // Capacity of table, minus one (capacity is always a power of two)
 	uint32_t        size;   // Size of table
-	struct node_u32 *nodes; // Array of nodes
+	struct node_u32 *nodes; // Array of nodes (NULL until the first insertion)
 };
 
 
@@ -40,6 +46,67 @@ static uint32_t _hash_u32_u32(uint32_t key) {
 }
 
 
+// Find the slot holding "key", or return -1 if it is not in the table
+static int64_t _find_u32(const struct htable_u32 *ht, uint32_t key) {
+	uint32_t i, dist;
+	if (!ht->nodes || !ht->size) {
+		return -1;
+	}
+	i = _hash_u32_u32(key) & ht->mask;
+	// With robin hood ordering, a key can't be further from home than the node in its way
+	for (dist = 1; ht->nodes[i].dist >= dist; dist++) {
+		if (ht->nodes[i].key == key) {
+			return i;
+		}
+		i = (i + 1) & ht->mask;
+	}
+	return -1;
+}
+
+
+// Insert a node known not to be in the table, without growing
+static void _insert_u32(struct htable_u32 *ht, uint32_t key, void *val) {
+	struct node_u32 cur, tmp;
+	uint32_t i;
+	cur.key = key;
+	cur.val = val;
+	cur.dist = 1;
+	i = _hash_u32_u32(key) & ht->mask;
+	while (ht->nodes[i].dist) {
+		// Steal the slot from nodes closer to their home than we are
+		if (ht->nodes[i].dist < cur.dist) {
+			tmp = ht->nodes[i];
+			ht->nodes[i] = cur;
+			cur = tmp;
+		}
+		cur.dist++;
+		i = (i + 1) & ht->mask;
+	}
+	ht->nodes[i] = cur;
+	ht->size++;
+}
+
+
+// Reallocate the table with capacity "cap" (a power of two) and rehash every node
+static void _resize_u32(struct htable_u32 *ht, uint32_t cap) {
+	struct node_u32 *old = ht->nodes;
+	uint32_t oldcap = old ? ht->mask + 1 : 0;
+	uint32_t i;
+	if (!(ht->nodes = calloc(cap, sizeof(struct node_u32)))) {
+        printf("calloc()");
+        exit(1);
+	}
+	ht->mask = cap - 1;
+	ht->size = 0;
+	for (i = 0; i < oldcap; i++) {
+		if (old[i].dist) {
+			_insert_u32(ht, old[i].key, old[i].val);
+		}
+	}
+	free(old);
+}
+
+
 // Allocate a new hash table
 struct htable_u32* htable_u32_new(void) {
 	struct htable_u32 *ht;
@@ -58,9 +125,9 @@ void htable_u32_free(struct htable_u32 *ht, void (*free_cb) (void*)) {
         printf("NULL htable_u32");
         exit(1);
 	}
-	if (free_cb) {
-		for (i = 0;  i < ht->cap; i++) {
-			if (ht->nodes[i].val && ht->nodes[i].is_occ) {
+	if (free_cb && ht->nodes) {
+		for (i = 0; i <= ht->mask; i++) {
+			if (ht->nodes[i].dist && ht->nodes[i].val) {
 				free_cb(ht->nodes[i].val);
 			}
 		}
@@ -72,99 +139,51 @@ void htable_u32_free(struct htable_u32 *ht, void (*free_cb) (void*)) {
 
 // Does value exist in hash table?
 uint8_t htable_u32_contains(const struct htable_u32 *ht, uint32_t key) {
-	uint32_t i;
 	if (!ht) {
         printf("NULL htable_u32");
         exit(1);
 	}
-	if (!ht->cap || !ht->size) {
-		return 0;
-	}
-	i = _hash_u32_u32(key) % ht->cap;
-	while (ht->nodes[i].is_occ) {
-		if (ht->nodes[i].key == key) {
-			return 1;
-		}
-		i = (i + 1) % ht->cap;
-	}
-	return 0;
+	return _find_u32(ht, key) >= 0;
 }
 
 
 // Get value for key "key". If doesn't exist return NULL, and if "err" is not NULL place error
 // code in "err"
 void* htable_u32_get(struct htable_u32 *ht, uint32_t key, enum htable_err *err) {
-	uint32_t i;
+	int64_t i;
 	if (!ht) {
         printf("NULL htable_u32");
         exit(1);
 	}
-	if (!ht->cap || !ht->size) {
+	if ((i = _find_u32(ht, key)) < 0) {
 		if (err) {
 			*err = HTE_NOKEY;
 		}
 		return NULL;
 	}
-	i = _hash_u32_u32(key) % ht->cap;
-	while (ht->nodes[i].is_occ) {
-		if (ht->nodes[i].key == key) {
-			if (err) {
-				*err = HTE_OK;
-			}
-			return ht->nodes[i].val;
-		}
-		i = (i + 1) % ht->cap;
-	}
 	if (err) {
-		*err = HTE_NOKEY;
+		*err = HTE_OK;
 	}
-	return NULL;
+	return ht->nodes[i].val;
 }
 
 
 // Set value for key "key". Return status code
 enum htable_err htable_u32_set(struct htable_u32 *ht, uint32_t key, void *val) {
-	uint32_t i, j;
-	struct node_u32 *tmp;
 	if (!ht) {
         printf("NULL htable_u32");
         exit(1);
 	}
-	// Is table too small?
-	if (ht->cap <= ht->size << 1) {
-		// Allocate new table
-		if (!(tmp = calloc(ht->cap + HTU32_BLK, sizeof(struct node_u32)))) {
-            printf("calloc()");
-            exit(1);
-		}
-		// Rehash
-		for (i = 0; i < ht->cap; i++) {
-			if (!ht->nodes[i].is_occ) {
-				continue;
-			}
-			j = _hash_u32_u32(ht->nodes[i].key) % (ht->cap + HTU32_BLK);
-			while (tmp[j].is_occ) {
-				j = (j + 1) % (ht->cap + HTU32_BLK);
-			}
-			tmp[j] = ht->nodes[i];
-		}
-		// Cleanup
-		free(ht->nodes);
-		ht->nodes = tmp;
-		ht->cap += HTU32_BLK;
-	}
-	// Hash new key
-	i = _hash_u32_u32(key) % ht->cap;
-	while (ht->nodes[i].is_occ) {
-		if (ht->nodes[i].key == key) {
-			return HTE_EXIST;
-		}
-		i = (i + 1) % ht->cap;
+	if (_find_u32(ht, key) >= 0) {
+		return HTE_EXIST;
 	}
-	ht->nodes[i].key = key;
-	ht->nodes[i].val = val;
-	ht->nodes[i].is_occ = 1;
-	ht->size++;
+	// Is table too small? Grow geometrically so insertion is amortised O(1)
+	if (!ht->nodes) {
+		_resize_u32(ht, HTU32_MIN_CAP);
+	} else if (ht->size + 1 > HTU32_MAX_LOAD(ht->mask + 1)) {
+		_resize_u32(ht, (ht->mask + 1) << 1);
+	}
+	_insert_u32(ht, key, val);
 	return HTE_OK;
 }
 
@@ -172,31 +191,35 @@ enum htable_err htable_u32_set(struct htable_u32 *ht, uint32_t key, void *val) {
 // Delete and r eturn value for key "key". If doesn't exist return NULL, and if "err" is not
 // NULL place error code in "err"
 void* htable_u32_pop(struct htable_u32 *ht, uint32_t key, enum htable_err *err) {
-	uint32_t i;
+	int64_t found;
+	uint32_t i, next;
+	void *val;
 	if (!ht) {
         printf("NULL htable_u32");
         exit(1);
 	}
-	if (!ht->cap || !ht->size) {
+	if ((found = _find_u32(ht, key)) < 0) {
 		if (err) {
 			*err = HTE_NOKEY;
 		}
 		return NULL;
 	}
-	i = _hash_u32_u32(key) % ht->cap;
-	while (ht->nodes[i].is_occ) {
-		if (ht->nodes[i].key == key) {
-			if (err) {
-				*err = HTE_OK;
-			}
-			ht->nodes[i].is_occ = 0;
-			ht->size--;
-			return ht->nodes[i].val;
-		}
-		i = (i + 1) % ht->cap;
-	}
+	i = (uint32_t)found;
+	val = ht->nodes[i].val;
+	// Backward-shift deletion: pull following displaced nodes one slot closer to home, so probe
+	// chains stay unbroken without tombstones
+	next = (i + 1) & ht->mask;
+	while (ht->nodes[next].dist > 1) {
+		ht->nodes[i] = ht->nodes[next];
+		ht->nodes[i].dist--;
+		i = next;
+		next = (next + 1) & ht->mask;
+	}
+	ht->nodes[i].dist = 0;
+	ht->nodes[i].val = NULL;
+	ht->size--;
 	if (err) {
-		*err = HTE_NOKEY;
+		*err = HTE_OK;
 	}
-	return NULL;
+	return val;
 }
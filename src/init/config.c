@@ -13,10 +13,19 @@
 
 #include "inih/ini.h"
 
+#include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+/**
+ * Values returned by getopt_long() for options that only have a long form.
+ */
+enum {
+    OPT_PROFILE_STARTUP = 0x100
+};
+
 static void usage(char *const argv0);
 static void version(void);
 
@@ -24,13 +33,19 @@ static void version(void);
 static char *get_config_path(char *const override);
 static uint8_t load_config_file(char *const path, session_config_t *conf);
 static int inih_handler(void *user, const char *sect, const char *name, const char *val);
+// Parse a non-negative integer config value, or return `def` if it isn't one.
+static uint32_t strtouint(const char *s, uint32_t def);
 
 static session_config_t session_config = {
     .force_randr_1_4 = 0,
     .force_xinerama = 0,
+    .profile_startup = 0,
 
     .drag_n_drop = {
-        .meta_dragging = 1
+        .meta_dragging = 1,
+        .pace_to_refresh = 0,
+        .outline = 0,
+        .snap_threshold = 10
     }
 };
 
@@ -41,7 +56,12 @@ uint8_t get_session_config(const int argc, char **const argv, session_config_t *
 
     char *const argv0 = argv[0];
 
-    while ((opt = getopt(argc, argv, "p:RXhV")) != -1) {
+    static const struct option longopts[] = {
+        { "profile-startup", no_argument, NULL, OPT_PROFILE_STARTUP },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((opt = getopt_long(argc, argv, "p:RXhV", longopts, NULL)) != -1) {
         switch (opt) {
             case 'p':
                 free(cfgpathoverride); // in case of multiple -p flags
@@ -54,6 +74,9 @@ uint8_t get_session_config(const int argc, char **const argv, session_config_t *
             case 'X':
                 session_config.force_xinerama = 1;
                 break;
+            case OPT_PROFILE_STARTUP:
+                session_config.profile_startup = 1;
+                break;
             case 'h':
                 usage(argv0);
                 goto abrtsucc;
@@ -93,7 +116,7 @@ abrt:
 }
 
 static void usage(char *const argv0) {
-    fprintf(stderr, "Usage: %s [-h] [-V] [-R | -X] [-p path]\n", argv0);
+    fprintf(stderr, "Usage: %s [-h] [-V] [-R | -X] [-p path] [--profile-startup]\n", argv0);
 
     // the following should be removed and replaced with a man page or something
     fprintf(stderr, "\n");
@@ -102,6 +125,8 @@ static void usage(char *const argv0) {
     fprintf(stderr, "    -R         Force older RandR <=1.4 functions if applicable\n");
     fprintf(stderr, "    -X         Force very old Xinerama API instead of RandR\n");
     fprintf(stderr, "\n");
+    fprintf(stderr, "    --profile-startup  Log how long each phase of startup takes\n");
+    fprintf(stderr, "\n");
     fprintf(stderr, "    -h         Print this help message\n");
     fprintf(stderr, "    -V         Print the version\n");
 }
@@ -192,6 +217,12 @@ static int inih_handler(void *user, const char *sect, const char *name, const ch
     READSECT("DRAG_N_DROP",
         if (READNAME("meta_dragging")) {
             conf->drag_n_drop.meta_dragging = STRTOBOOL(val, 1);
+        } else if (READNAME("pace_to_refresh")) {
+            conf->drag_n_drop.pace_to_refresh = STRTOBOOL(val, 0);
+        } else if (READNAME("outline")) {
+            conf->drag_n_drop.outline = STRTOBOOL(val, 0);
+        } else if (READNAME("snap_threshold")) {
+            conf->drag_n_drop.snap_threshold = strtouint(val, 10);
         }
     );
 
@@ -201,3 +232,16 @@ static int inih_handler(void *user, const char *sect, const char *name, const ch
 
     return 1;
 }
+
+static uint32_t strtouint(const char *s, uint32_t def) {
+    char *end;
+
+    errno = 0;
+    const unsigned long v = strtoul(s, &end, 10);
+    if (end == s || *end != '\0' || *s == '-' || errno || v > UINT32_MAX) {
+        LWARN("Invalid unsigned integer config value '%s'", s);
+        return def;
+    }
+
+    return (uint32_t)v;
+}
@@ -22,10 +22,18 @@ typedef struct session_config_t {
     uint8_t force_xinerama;
     /** Force RandR versions 1.4 and below to be used regardless of whether RandR 1.5 is available or not. */
     uint8_t force_randr_1_4;
+    /** Log wall-clock timings of each startup phase. */
+    uint8_t profile_startup;
 
     struct {
         /** Enable the meta-dragging feature */
         uint8_t meta_dragging;
+        /** Commit client geometry at most once per refresh interval of the client's monitor while dragging */
+        uint8_t pace_to_refresh;
+        /** Draw an outline of the client's geometry while dragging, and only apply it once the drag ends */
+        uint8_t outline;
+        /** Distance in pixels within which dragged client edges snap to the edges of other clients and monitors (0 to disable snapping) */
+        uint32_t snap_threshold;
     } drag_n_drop;
 } session_config_t;
 
@@ -8,12 +8,15 @@
 #include "init/config.h"
 #include "init/sighandle.h"
 #include "manager/session.h"
+#include "util/genutil.h"
 #include "util/logging.h"
 #include "util/xstr.h"
 #include "version.h"
 
 #include <xcb/xcb.h>
 
+#include <inttypes.h>
+
 xcb_connection_t *con;
 
 session_t session;
@@ -34,26 +37,42 @@ int main(int argc, char **argv) {
 
     LINFO("AWM %d-bit version %s", (int)(8 * sizeof(void *)), AWM_VERSION_LONG);
 
+    // termination signals are read from a signalfd in the event loop rather than being handled asynchronously
+    const int sigfd = open_signal_fd();
+    if (sigfd < 0) {
+        LFATAL("Failed to set up signal handling");
+        KILL();
+    }
+
+    const uint64_t tstart = monotime_ns();
+
+    // connect to X server
+    con = xcb_connect(NULL, &scrnum);
+
     // set callbacks for controlled exits + cleanup
     set_signal_callbacks((signal_callback_data_t){
         .con = con,
         .session = &session
     });
 
-    // connect to X server
-    con = xcb_connect(NULL, &scrnum);
     if ((conerr = xcb_connection_has_error(con))) {
         LFATAL("Failed to make X connection: (%s)%s", xerrcode_str(conerr), (conerr != 1) ? "" : " - Does the display on $DISPLAY exist?");
         KILL();
     }
     LINFO("Connected to X on screen %d", scrnum);
 
+    const uint64_t tconnected = monotime_ns();
+
     // initialise window manager session
     session = session_init(con, scrnum, &sconfig);
 
-    for (;;) {
-        session_handle_next_event(&session);
+    if (sconfig.profile_startup) {
+        LINFO("Startup profile: %-28s %8" PRIu64 " us", "connecting to X", (tconnected - tstart) / 1000);
+        LINFO("Startup profile: %-28s %8" PRIu64 " us", "total", (monotime_ns() - tstart) / 1000);
     }
 
+    // handle events until signalled to stop
+    session_run(&session, sigfd);
+
     return 0;
 }
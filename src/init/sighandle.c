@@ -11,10 +11,13 @@
 #include "util/logging.h"
 
 #include <xcb/xcb.h>
+#include <errno.h>
 #include <signal.h>
+#include <string.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 
 static void exit_cb(void); // called on exit()
-static void sigint_cb(int sig); // called on SIGINT (e.g. recieved ^C)
 
 // static global used to pass data to the callback functions
 static signal_callback_data_t cb_data;
@@ -24,7 +27,42 @@ void set_signal_callbacks(signal_callback_data_t data){
 
     // set up callbacks to clean up objects on exit
     atexit(exit_cb);
-    signal(SIGINT, sigint_cb);
+}
+
+int open_signal_fd(void) {
+    sigset_t mask;
+    int fd;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigaddset(&mask, SIGHUP);
+
+    // block asynchronous delivery, so the signals stay pending until they are read from the signalfd
+    if (sigprocmask(SIG_BLOCK, &mask, NULL) < 0) {
+        LERR("sigprocmask() fault (errno %d)", errno);
+        return -1;
+    }
+
+    fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        LERR("signalfd() fault (errno %d)", errno);
+        return -1;
+    }
+
+    return fd;
+}
+
+int read_signal_fd(const int fd) {
+    struct signalfd_siginfo info;
+
+    if (read(fd, &info, sizeof(info)) != sizeof(info)) {
+        return 0;
+    }
+
+    LINFO("Recieved signal %u (%s)", info.ssi_signo, strsignal(info.ssi_signo));
+
+    return (int)info.ssi_signo;
 }
 
 static void exit_cb(void) {
@@ -33,9 +71,3 @@ static void exit_cb(void) {
     session_dealloc(cb_data.session);
     xcb_disconnect(cb_data.con); // this must be done regardless of if there was an issue with connecting or not
 }
-
-static void sigint_cb(int sig) {
-    signal(sig, SIG_IGN); // ignore signal, override default behaviour with this handler
-
-    KILLSUCC(); // will result in exit_cb() call
-}
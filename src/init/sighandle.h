@@ -27,12 +27,25 @@ typedef struct signal_callback_data_t {
 } signal_callback_data_t;
 
 /**
- * Set callback functions for handling process signals.
+ * Set callback functions for cleaning up when the process exits.
  */
 void set_signal_callbacks(
     signal_callback_data_t data
 );
 
+/**
+ * Block asynchronous delivery of termination signals (SIGINT, SIGTERM and SIGHUP) and return a signalfd from which they can be read instead, so
+ * they are handled synchronously in the event loop. -1 is returned if there was an error.
+ */
+int open_signal_fd(void);
+
+/**
+ * Read the next pending signal from signalfd `fd` and return its number, or 0 if none are pending.
+ */
+int read_signal_fd(
+    const int fd
+);
+
 #ifdef __cplusplus
     }
 #endif
@@ -17,22 +17,41 @@
     __ATOMS_OWNED_ICCCM
 #undef xm
 
-const char *atoms_init_owned(xcb_connection_t *con) {
+atoms_cookies_t atoms_request_owned(xcb_connection_t *con) {
+    atoms_cookies_t cookies;
+
+    // attempt to create each atom (or get if it already exists) - all requests are sent before any replies are waited on
+#   define xm(m) \
+        cookies.intern[ATOMS_IDX_##m] = xcb_intern_atom(con, 0, strlen(#m), #m);
+
+        __ATOMS_OWNED_EWMH
+        __ATOMS_OWNED_ICCCM
+#   undef xm
+
+    return cookies;
+}
+
+const char *atoms_collect_owned(xcb_connection_t *con, const atoms_cookies_t *const cookies) {
+    const char *failed = NULL;
+
+    // every reply is collected, even after a failure, so none are left pending
 #   define xm(m)                                                                            \
         {                                                                                   \
-            /* Attempt to create each atom (or get if it already exists) */                 \
             xcb_intern_atom_reply_t *reply =                                                \
-                xcb_intern_atom_reply(con, xcb_intern_atom(con, 0, strlen(#m), #m), NULL);  \
+                xcb_intern_atom_reply(con, cookies->intern[ATOMS_IDX_##m], NULL);           \
             if (!reply) {                                                                   \
-                return #m;                                                                  \
+                if (!failed) {                                                              \
+                    failed = #m;                                                            \
+                }                                                                           \
+            } else {                                                                        \
+                ATOMS_##m = reply->atom;                                                    \
+                free(reply);                                                                \
             }                                                                               \
-            ATOMS_##m = reply->atom;                                                        \
-            free(reply);                                                                    \
         }
 
         __ATOMS_OWNED_EWMH
         __ATOMS_OWNED_ICCCM
 #   undef xm
 
-    return NULL;
+    return failed;
 }
@@ -16,10 +16,14 @@
  * A list of all EWMH-compliant atoms to be created and managed by the Awm session.
  * Before reading this macro, define a macro called `xm()` to expand/manipulate each item in the list.
  */
-#define __ATOMS_OWNED_EWMH          \
-    xm(_NET_WM_NAME)                \
-    xm(_NET_WM_STATE)               \
-    xm(_NET_WM_STATE_FULLSCREEN)    \
+#define __ATOMS_OWNED_EWMH           \
+    xm(_NET_ACTIVE_WINDOW)           \
+    xm(_NET_CLIENT_LIST_STACKING)    \
+    xm(_NET_WM_NAME)                 \
+    xm(_NET_WM_STATE)                \
+    xm(_NET_WM_STATE_FULLSCREEN)     \
+    xm(_NET_WM_SYNC_REQUEST)         \
+    xm(_NET_WM_SYNC_REQUEST_COUNTER) \
 
 /**
  * A list of all ICCCM-compliant atoms to be created and managed by the Awm session.
@@ -28,7 +32,9 @@
  * Note that some atoms are automatically available from libxcb and so aren't in this list.
  */
 #define __ATOMS_OWNED_ICCCM \
+    xm(WM_PROTOCOLS)        \
     xm(WM_STATE)            \
+    xm(WM_TAKE_FOCUS)       \
 
 /**
  * Default value for Awm-managed X atoms before they are created and set.
@@ -42,12 +48,42 @@
     __ATOMS_OWNED_ICCCM
 #undef xm
 
+#define xm(m) \
+    ATOMS_IDX_##m,
+
+/**
+ * Indices of Awm-managed atoms, e.g. into `atoms_cookies_t`.
+ */
+enum {
+    __ATOMS_OWNED_EWMH
+    __ATOMS_OWNED_ICCCM
+
+    /** Amount of Awm-managed atoms */
+    ATOMS_OWNED_COUNT
+};
+#undef xm
+
+/**
+ * Cookies of pending InternAtom requests for each Awm-managed atom, as returned by `atoms_request_owned()`.
+ */
+typedef struct atoms_cookies_t {
+    xcb_intern_atom_cookie_t intern[ATOMS_OWNED_COUNT];
+} atoms_cookies_t;
+
 /**
- * Create/retrieve all necessary atoms (contents of `ATOMS_OWNED_EWMH` and `ATOMS_OWNED_ICCCM`).
- * If error, then the name of the causing atom is returned statically, otherwise NULL is returned.
+ * Send (but don't wait for) requests to create/retrieve all necessary atoms (contents of `ATOMS_OWNED_EWMH` and `ATOMS_OWNED_ICCCM`).
  */
-const char *atoms_init_owned(
+atoms_cookies_t atoms_request_owned(
     xcb_connection_t *con
 );
 
+/**
+ * Collect the replies to requests sent with `atoms_request_owned()` and set each atom.
+ * If error, then the name of the (first) causing atom is returned statically, otherwise NULL is returned.
+ */
+const char *atoms_collect_owned(
+    xcb_connection_t *con,
+    const atoms_cookies_t *const cookies
+);
+
 #endif
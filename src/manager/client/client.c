@@ -8,42 +8,120 @@
 #include "client.h"
 
 #include "manager/atoms.h"
+#include "manager/session.h"
 #include "util/genutil.h"
 #include "util/logging.h"
-#include "util/xstr.h"
 
 #include <xcb/xcb_icccm.h>
 
+#include <string.h>
+
 /**
- * Create a frame for the given client.
+ * Length of edge grips along their edge. Edge grips are longer than any frame and clipped by it, so together with their window gravity they never
+ * need to be resized along with the frame.
+ */
+#define GRIP_LENGTH 0x7fff
+
+/**
+ * Create a frame for the given client, or take one from the session's frame pool.
  */
 static xcb_window_t frame_create(
-    xcb_connection_t *const con,
-    xcb_screen_t *const scr,
+    session_t *const session,
     client_t *const client
 );
 
+/**
+ * Create a frame window with geometry `rect`, along with resize grips laid out for inner margin `margin`, into `out`. Errors are attributed to
+ * inner window `owner` (or XCB_NONE) and handled by `handler`. Returns 0 if no ID could be allocated for the frame window.
+ */
+static uint8_t frame_windows_create(
+    session_t *const session,
+    const rect_t rect,
+    const margin_t margin,
+    const xcb_window_t owner,
+    const errtable_handler_t handler,
+    clientframe_t *const out
+);
+
+/**
+ * Compute the rectangles of the resize grips of a frame with size `frame` and inner margin `margin`, relative to the frame. Grips on the left, right
+ * and bottom are as thick as the frame's margin on that side; the top grip is only as thick as the left margin, so the rest of the title bar is left
+ * for moving the client. Edge grips are `GRIP_LENGTH` long, and corner grips are stacked above them. A grip has zero width or height if the margin it
+ * is on is empty.
+ */
+static void grips_layout(
+    const margin_t margin,
+    const extent_t frame,
+    rect_t *const out
+);
+
+/**
+ * Create (and map) the resize grips of `frame`, which has size `extent` and inner margin `margin`. Errors are attributed to inner window `owner`.
+ */
+static void grips_create(
+    session_t *const session,
+    clientframe_t *const frame,
+    const margin_t margin,
+    const extent_t extent,
+    const xcb_window_t owner
+);
+
+/**
+ * Destroy every frame in the session's frame pool.
+ */
+static void framepool_clear(
+    session_t *const session
+);
+
 /**
  * Register/grab buttons for click events (e.g. raise+focus on click) as well as events on the frame of the given client if applicable
  */
 static void register_client_events(
-    xcb_connection_t *const con,
+    session_t *const session,
+    client_t *const client
+);
+
+/**
+ * Grab mouse buttons on the inner window of an unfocused client, so a click on it can focus and raise it (and can then be replayed to the client).
+ */
+static void grab_click_buttons(
+    session_t *const session,
+    client_t *const client
+);
+
+/**
+ * Replace the click grabs on the inner window of a newly focused client with a grab only for meta-dragging (if enabled), so ordinary clicks in the
+ * focused client go straight to it without passing through the window manager.
+ */
+static void grab_meta_buttons(
+    session_t *const session,
     client_t *const client
 );
 
+/**
+ * Error table handler: a request needed for the client to be framed failed, so stop managing it.
+ */
+static void unmanage_on_error(
+    session_t *const session,
+    const errtable_entry_t *const entry,
+    xcb_generic_error_t *const err
+);
+
 void client_dealloc(client_t *const client) {
     clientprops_dealloc(&client->properties);
-
-    free(client);
 }
 
-client_t client_init_framed(xcb_connection_t *const con, xcb_screen_t *const scr, const xcb_window_t inner) {
-    xcb_generic_error_t *err;
+client_t client_init_framed(session_t *const session, const xcb_window_t inner, const clientprops_t props) {
+    xcb_connection_t *const con = session->con;
+    errtable_t *const errtable = &session->errtable;
 
     client_t client;
+    memset(&client, 0, sizeof(client_t));
 
     client.inner = inner;
-    client.properties = clientprops_init_all(con, inner);
+    client.properties = props;
+    client.spatialid = SPATIAL_ID_NONE;
+    client.monitor = MONITORSET_INDEX_NONE;
 
     // geometry may have been updated when getting reading properties so update this on the window
     xcb_configure_window(
@@ -54,7 +132,7 @@ client_t client_init_framed(xcb_connection_t *const con, xcb_screen_t *const scr
             client.properties.rect.extent.height
         });
 
-    client.frame = frame_create(con, scr, &client);
+    client.frame = frame_create(session, &client);
     if (client.frame == (xcb_window_t)-1) {
         // error
         goto out;
@@ -63,32 +141,18 @@ client_t client_init_framed(xcb_connection_t *const con, xcb_screen_t *const scr
     const xcb_window_t frame = client.frame;
 
     // reparent inner under frame...
-    xcb_void_cookie_t rcookies[3];
+    // these requests are not checked here: if any of them fail, the error is attributed to this client when it arrives and the client is unmanaged
 
     // set the border width of the inner window to 0 as we have our own
-    rcookies[0] = xcb_configure_window_checked(con, inner,
-        XCB_CONFIG_WINDOW_BORDER_WIDTH, (uint32_t[]) { 0 });
+    errtable_track(errtable, xcb_configure_window(con, inner, XCB_CONFIG_WINDOW_BORDER_WIDTH, (uint32_t[]) { 0 }),
+        inner, "setting inner border width", unmanage_on_error);
 
     // reparent inner window under frame
-    rcookies[1] = xcb_reparent_window_checked(
-        con, inner, frame,
-        client.properties.innermargin.left, client.properties.innermargin.top);
+    errtable_track(errtable, xcb_reparent_window(con, inner, frame, client.properties.innermargin.left, client.properties.innermargin.top),
+        inner, "reparenting inner under frame", unmanage_on_error);
 
     // map frame
-    rcookies[2] = xcb_map_window_checked(con, frame);
-
-    xcb_flush(con);
-
-    // check void cookies from reparenting
-    for (uint32_t i = 0; i < sizeof(rcookies) / sizeof(rcookies[0]); i++) {
-        err = xcb_request_check(con, rcookies[i]);
-        if (err) {
-            LERR("When reparenting inner 0x%08x under frame 0x%08x: error %u (%s)", inner, frame, err->error_code, xerrcode_str(err->error_code));
-
-            free(err);
-            goto out;
-        }
-    }
+    errtable_track(errtable, xcb_map_window(con, frame), inner, "mapping frame", unmanage_on_error);
 
     // init WM_STATE on the inner window to comply with ICCCM (also makes xprop work)
     xcb_change_property(con, XCB_PROP_MODE_REPLACE, inner, ATOMS_WM_STATE, ATOMS_WM_STATE, 32, 2,
@@ -99,43 +163,152 @@ client_t client_init_framed(xcb_connection_t *const con, xcb_screen_t *const scr
     LLOG("New client: inner window 0x%08x reparented under 0x%08x (framed)", inner, frame);
 
     // register event masks on client
-    register_client_events(con, &client);
+    register_client_events(session, &client);
+
+    session_defer_flush(session);
 
 out:
     return client;
 }
 
-void client_frame_destroy(xcb_connection_t *const con, client_t *const client, const xcb_window_t root) {
+void client_frame_destroy(session_t *const session, client_t *const client, const xcb_window_t root) {
+    xcb_connection_t *const con = session->con;
+
     const xcb_window_t inner = client->inner;
     const xcb_window_t frame = client->frame;
 
+    clientframepool_t *const pool = &session->framepool;
+
     // request to reparent under root
     // note, this results in BadWindow error (for some reason), but doesn't seem to cause any problems
     xcb_reparent_window(con, inner, root, 0, 0);
 
-    xcb_flush(con);
+    // keep the frame for the next client if there is room in the pool (and it is laid out for the margin pooled frames have), otherwise destroy it
+    if (!client->framefailed && pool->len < CLIENT_FRAMEPOOL_CAP &&
+        memcmp(&pool->margin, &client->properties.innermargin, sizeof(margin_t)) == 0)
+    {
+        xcb_unmap_window(con, frame);
 
-    // destroy frame
-    xcb_destroy_window(con, frame);
+        clientframe_t *const pooled = &pool->frames[pool->len++];
+        pooled->frame = frame;
+        memcpy(pooled->grips, client->grips, sizeof(client->grips));
+    } else {
+        xcb_destroy_window(con, frame);
+    }
     client->frame = 0;
+    memset(client->grips, 0, sizeof(client->grips));
+
+    session_defer_flush(session);
 }
 
-void client_raise(xcb_connection_t *const con, client_t *const client) {
-    const xcb_window_t frame = client->frame;
+void client_framepool_refill(session_t *const session) {
+    clientframepool_t *const pool = &session->framepool;
+
+    // the margin to lay frames out for is only known once a client has been framed
+    if (!pool->ready || pool->len >= CLIENT_FRAMEPOOL_CAP) {
+        return;
+    }
+
+    const margin_t margin = pool->margin;
+
+    // pooled frames are created unmapped at the root origin, for the smallest possible inner window
+    const rect_t rect = {
+        .extent = { margin.left + margin.right + 1, margin.top + margin.bottom + 1 },
+        .offset = { 0, 0 }
+    };
+
+    while (pool->len < CLIENT_FRAMEPOOL_CAP) {
+        if (!frame_windows_create(session, rect, margin, XCB_NONE, NULL, &pool->frames[pool->len])) {
+            LWARN("Failed to allocate frame window ID for the frame pool");
+            break;
+        }
+        pool->len++;
+    }
+
+    session_defer_flush(session);
+}
+
+void client_framepool_dealloc(session_t *const session) {
+    framepool_clear(session);
+}
 
-    xcb_configure_window(con, frame,
-        XCB_CONFIG_WINDOW_STACK_MODE,
-        (uint32_t []) { XCB_STACK_MODE_ABOVE });
-    xcb_flush(con);
+void client_raise(session_t *const session, client_t *const client) {
+    stack_raise(session, client);
 }
 
-void client_focus(xcb_connection_t *const con, client_t *const client) {
+void client_focus(session_t *const session, client_t *const client, const xcb_timestamp_t time) {
+    xcb_connection_t *const con = session->con;
+
     const xcb_window_t inner = client->inner;
+    const clientprops_t *const props = &client->properties;
+
+    // redundant focus (e.g. clicking on the focused client)
+    if (clientset_get(&session->clientset, session->focused) == client) {
+        session->evstats.focus_skipped++;
+        return;
+    }
+
+    // clients with the 'No Input' model never take focus
+    if (!props->input && !props->take_focus) {
+        return;
+    }
+
+    // 'Passive' and 'Locally Active' clients are given focus directly
+    if (props->input) {
+        xcb_set_input_focus(con, XCB_INPUT_FOCUS_POINTER_ROOT, inner, time);
+    }
+
+    // 'Locally Active' and 'Globally Active' clients are told to take focus themselves
+    if (props->take_focus) {
+        xcb_client_message_event_t ev;
+        memset(&ev, 0, sizeof(xcb_client_message_event_t));
+
+        ev.response_type = XCB_CLIENT_MESSAGE;
+        ev.format = 32;
+        ev.window = inner;
+        ev.type = ATOMS_WM_PROTOCOLS;
+        ev.data.data32[0] = ATOMS_WM_TAKE_FOCUS;
+        ev.data.data32[1] = time;
+
+        xcb_send_event(con, 0, inner, XCB_EVENT_MASK_NO_EVENT, (const char *)&ev);
+    }
+
+    // 'Globally Active' clients may ignore WM_TAKE_FOCUS, so they are only recorded as focused once their FocusIn arrives
+    if (props->input) {
+        client_set_focused(session, client);
+    }
 
-    xcb_set_input_focus(con, XCB_INPUT_FOCUS_POINTER_ROOT, inner, XCB_CURRENT_TIME);
+    session_defer_flush(session);
 }
 
-static xcb_window_t frame_create(xcb_connection_t *const con, xcb_screen_t *const scr, client_t *const client) {
+void client_set_focused(session_t *const session, client_t *const client) {
+    xcb_connection_t *const con = session->con;
+    clientset_t *const clientset = &session->clientset;
+
+    client_t *const prev = clientset_get(clientset, session->focused);
+    if (prev == client) {
+        return;
+    }
+
+    // clicks are only routed through the window manager on unfocused clients
+    if (prev) {
+        grab_click_buttons(session, prev);
+    }
+    if (client) {
+        grab_meta_buttons(session, client);
+    }
+
+    session->focused = (client) ? clientset_handle(clientset, client) : CLIENT_HANDLE_NONE;
+
+    const xcb_window_t active = (client) ? client->inner : XCB_NONE;
+    xcb_change_property(con, XCB_PROP_MODE_REPLACE, session->root, ATOMS__NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, &active);
+
+    session_defer_flush(session);
+}
+
+static xcb_window_t frame_create(session_t *const session, client_t *const client) {
+    xcb_connection_t *const con = session->con;
+
     const xcb_window_t inner = client->inner;
     const clientprops_t props = client->properties;
 
@@ -157,21 +330,68 @@ static xcb_window_t frame_create(xcb_connection_t *const con, xcb_screen_t *cons
     client->properties.rect.offset.x = framerect.offset.x + margin.left;
     client->properties.rect.offset.y = framerect.offset.y + margin.top;
 
+    clientframepool_t *const pool = &session->framepool;
+
+    // pooled frames are laid out for the margin of the latest client, so any left over for another margin are of no use
+    if (!pool->ready || memcmp(&pool->margin, &margin, sizeof(margin_t)) != 0) {
+        framepool_clear(session);
+        pool->margin = margin;
+        pool->ready = 1;
+    }
+
+    clientframe_t frame;
+
+    if (pool->len) {
+        // reuse a pooled frame: it already has its event masks and grips, so it only needs to be moved and resized into place
+        frame = pool->frames[--pool->len];
+        client->frame = frame.frame;
+        memcpy(client->grips, frame.grips, sizeof(client->grips));
+
+        errtable_track(&session->errtable, xcb_configure_window(con, frame.frame,
+            XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+            (uint32_t []) {
+                framerect.offset.x, framerect.offset.y,
+                framerect.extent.width, framerect.extent.height
+            }), inner, "configuring pooled frame", unmanage_on_error);
+
+        session->evstats.frames_reused++;
+
+        return frame.frame;
+    }
+
+    // create frame window (errors, e.g. BadAlloc, are handled when they arrive by unmanaging the client)
+    if (!frame_windows_create(session, framerect, margin, inner, unmanage_on_error, &frame)) {
+        LERR("Failed to allocate frame window ID for inner 0x%08x", inner);
+        return -1;
+    }
+
+    client->frame = frame.frame;
+    memcpy(client->grips, frame.grips, sizeof(client->grips));
+
+    return frame.frame;
+}
+
+static uint8_t frame_windows_create(session_t *const session, const rect_t rect, const margin_t margin, const xcb_window_t owner,
+    const errtable_handler_t handler, clientframe_t *const out)
+{
+    xcb_connection_t *const con = session->con;
+    xcb_screen_t *const scr = session->scr;
+
     const xcb_window_t root = scr->root;
     const xcb_window_t rootvis = scr->root_visual;
 
-    xcb_generic_error_t *err = NULL;
-
     // TODO: stop hardcoding this value
     const uint32_t framecol = 0xff0000;
 
-    xcb_window_t frame = xcb_generate_id(con);
+    const xcb_window_t frame = xcb_generate_id(con);
+    if (frame == (xcb_window_t)-1) {
+        return 0;
+    }
 
-    // create frame window
-    err = xcb_request_check(con, xcb_create_window_checked(
+    errtable_track(&session->errtable, xcb_create_window(
         con, XCB_COPY_FROM_PARENT, frame, root,
-        framerect.offset.x, framerect.offset.y,
-        framerect.extent.width, framerect.extent.height,
+        rect.offset.x, rect.offset.y,
+        rect.extent.width, rect.extent.height,
         0,
         XCB_WINDOW_CLASS_INPUT_OUTPUT, rootvis,
         XCB_CW_BACK_PIXEL | XCB_CW_EVENT_MASK,
@@ -179,56 +399,172 @@ static xcb_window_t frame_create(xcb_connection_t *const con, xcb_screen_t *cons
             framecol,
             XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_BUTTON_PRESS
         }
-    ));
+    ), owner, "creating frame window", handler);
 
-    if (err) {
-        LERR("Failed to create frame window for inner 0x%08x: error %u (%s)", inner, err->error_code, xerrcode_str(err->error_code));
-        xcb_destroy_window(con, frame);
+    out->frame = frame;
+    grips_create(session, out, margin, rect.extent, owner);
 
-        free(err);
-        return -1;
+    return 1;
+}
+
+static void grips_layout(const margin_t margin, const extent_t frame, rect_t *const out) {
+    // the top margin holds the title bar, so only a strip along its top edge (as thick as the side margins) resizes the client - the rest of the
+    // title bar stays clickable on the frame itself, for moving the client
+    const uint32_t l = margin.left, r = margin.right, t = min(margin.top, margin.left), b = margin.bottom;
+    const uint32_t w = frame.width, h = frame.height;
+
+    // in the order of the grip roles: left, right, top, bottom, then the corners
+    // (edge grips run from the top or left of the frame and are clipped by it; where they overlap at the corners, the corner grips are on top)
+    const rect_t rects[CLIENT_GRIP_COUNT] = {
+        { { l, GRIP_LENGTH }, { 0, 0 } },
+        { { r, GRIP_LENGTH }, { w - r, 0 } },
+        { { GRIP_LENGTH, t }, { 0, 0 } },
+        { { GRIP_LENGTH, b }, { 0, h - b } },
+        { { l, t },         { 0, 0 } },
+        { { r, t },         { w - r, 0 } },
+        { { l, b },         { 0, h - b } },
+        { { r, b },         { w - r, h - b } },
+    };
+    memcpy(out, rects, sizeof(rects));
+}
+
+static void grips_create(session_t *const session, clientframe_t *const frame, const margin_t margin, const extent_t extent,
+    const xcb_window_t owner)
+{
+    xcb_connection_t *const con = session->con;
+
+    // gravity of each grip, so that the server keeps it on its edge or corner as the frame is resized
+    static const uint32_t gravities[CLIENT_GRIP_COUNT] = {
+        XCB_GRAVITY_NORTH_WEST, XCB_GRAVITY_NORTH_EAST, XCB_GRAVITY_NORTH_WEST, XCB_GRAVITY_SOUTH_WEST,
+        XCB_GRAVITY_NORTH_WEST, XCB_GRAVITY_NORTH_EAST, XCB_GRAVITY_SOUTH_WEST, XCB_GRAVITY_SOUTH_EAST
+    };
+
+    rect_t rects[CLIENT_GRIP_COUNT];
+    grips_layout(margin, extent, rects);
+
+    for (uint32_t i = 0; i < CLIENT_GRIP_COUNT; i++) {
+        frame->grips[i] = XCB_NONE;
+
+        if (!rects[i].extent.width || !rects[i].extent.height) {
+            continue;
+        }
+
+        const xcb_window_t grip = xcb_generate_id(con);
+        if (grip == (xcb_window_t)-1) {
+            LWARN("Failed to allocate resize grip window ID for frame 0x%08x", frame->frame);
+            continue;
+        }
+
+        // the cursor is set once here, and from then on the server changes it as the pointer crosses grips
+        // (grips are created in role order, so corner grips are stacked above the edge grips they overlap)
+        errtable_track(&session->errtable, xcb_create_window(
+            con, 0, grip, frame->frame,
+            rects[i].offset.x, rects[i].offset.y,
+            rects[i].extent.width, rects[i].extent.height,
+            0,
+            XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT,
+            XCB_CW_WIN_GRAVITY | XCB_CW_EVENT_MASK | XCB_CW_CURSOR,
+            (uint32_t []) {
+                gravities[i],
+                XCB_EVENT_MASK_BUTTON_PRESS,
+                session->gripcursors[i]
+            }
+        ), owner, "creating resize grip", NULL);
+
+        frame->grips[i] = grip;
     }
 
-    return frame;
+    // (no inner window is reparented under the frame yet, so only grips are mapped)
+    xcb_map_subwindows(con, frame->frame);
 }
 
-static void register_client_events(xcb_connection_t *const con, client_t *const client) {
-    xcb_generic_error_t *err;
-    xcb_void_cookie_t vcookies[4];
+static void framepool_clear(session_t *const session) {
+    clientframepool_t *const pool = &session->framepool;
+
+    // grips are destroyed along with their frames
+    while (pool->len) {
+        xcb_destroy_window(session->con, pool->frames[--pool->len].frame);
+    }
+
+    session_defer_flush(session);
+}
+
+static void register_client_events(session_t *const session, client_t *const client) {
+    xcb_connection_t *const con = session->con;
+    errtable_t *const errtable = &session->errtable;
 
     const xcb_window_t inner = client->inner;
-    const xcb_window_t frame = client->frame;
 
     // request to recieve events on inner window
-    vcookies[0] = xcb_change_window_attributes_checked(con, inner, XCB_CW_EVENT_MASK,
+    errtable_track(errtable, xcb_change_window_attributes(con, inner, XCB_CW_EVENT_MASK,
         (uint32_t[]){
-            XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY
-        });
+            XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_FOCUS_CHANGE
+        }), inner, "registering events on inner", NULL);
 
-    // grab left, middle, and right mouse buttons for click-to-raise and drag-n-drop functionality
-    for (uint16_t i = 1; i < 4; i++) {
-        uint8_t btnid = i-1;
+    // clients start off unfocused
+    grab_click_buttons(session, client);
+}
 
+static void grab_click_buttons(session_t *const session, client_t *const client) {
+    xcb_connection_t *const con = session->con;
+    errtable_t *const errtable = &session->errtable;
+
+    const xcb_window_t inner = client->inner;
+
+    // grab left, middle, and right mouse buttons for click-to-raise and drag-n-drop functionality
+    for (uint8_t btnid = XCB_BUTTON_INDEX_1; btnid <= XCB_BUTTON_INDEX_3; btnid++) {
         // important: the pointer mode is SYNC, *not* ASYNC - this is so events are queued until xcb_allow_events() called.
         //   this allows us to replay pointer/button events, propagating them to the client so they aren't lost (and the user can still click on it)
         //   (for more, see https://unix.stackexchange.com/a/397466)
-        vcookies[i] = xcb_grab_button_checked(con, 0, inner,
+        errtable_track(errtable, xcb_grab_button(con, 0, inner,
             XCB_EVENT_MASK_BUTTON_PRESS,
             XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC,
             XCB_NONE, XCB_NONE,
-            btnid, XCB_MOD_MASK_ANY);
+            btnid, XCB_MOD_MASK_ANY), inner, "grabbing buttons on inner", NULL);
     }
 
-    xcb_flush(con);
+    session_defer_flush(session);
+}
+
+static void grab_meta_buttons(session_t *const session, client_t *const client) {
+    xcb_connection_t *const con = session->con;
+    errtable_t *const errtable = &session->errtable;
+
+    const xcb_window_t inner = client->inner;
+
+    errtable_track(errtable, xcb_ungrab_button(con, XCB_BUTTON_INDEX_ANY, inner, XCB_MOD_MASK_ANY), inner, "ungrabbing buttons on inner", NULL);
 
-    // check void cookies
-    for (uint32_t i = 0; i < sizeof(vcookies) / sizeof(vcookies[0]); i++) {
-        if ((err = xcb_request_check(con, vcookies[i]))) {
-            LERR("When registering events on client (inner 0x%08x, frame 0x%08x): error %u (%s)", inner, frame, err->error_code,
-                xerrcode_str(err->error_code));
+    // only meta+LMB is still intercepted, for meta-dragging
+    // (grabbed with each combination of caps lock and num lock, which would otherwise stop the grab from matching)
+    if (session->cfg.drag_n_drop.meta_dragging) {
+        static const uint16_t lockmods[] = { 0, XCB_MOD_MASK_LOCK, XCB_MOD_MASK_2, XCB_MOD_MASK_LOCK | XCB_MOD_MASK_2 };
 
-            free(err);
-            return;
+        for (uint32_t i = 0; i < sizeof(lockmods) / sizeof(lockmods[0]); i++) {
+            errtable_track(errtable, xcb_grab_button(con, 0, inner,
+                XCB_EVENT_MASK_BUTTON_PRESS,
+                XCB_GRAB_MODE_SYNC, XCB_GRAB_MODE_ASYNC,
+                XCB_NONE, XCB_NONE,
+                XCB_BUTTON_INDEX_1, XCB_MOD_MASK_4 | lockmods[i]), inner, "grabbing meta-drag button on inner", NULL);
         }
     }
+
+    session_defer_flush(session);
+}
+
+static void unmanage_on_error(session_t *const session, const errtable_entry_t *const entry, xcb_generic_error_t *const err) {
+    // suppress unused parameter
+    (void)err;
+
+    // the client may already have been unmanaged, e.g. by an earlier error from the same batch of requests
+    client_t *const client = clientset_find_role(&session->clientset, entry->client, CLIENT_ROLE_INNER);
+    if (!client) {
+        return;
+    }
+
+    LWARN("Unmanaging window 0x%08x, which could not be framed", entry->client);
+
+    // the frame may be unusable, so it must not be reused
+    client->framefailed = 1;
+
+    session_unmanage_client(session, client);
 }
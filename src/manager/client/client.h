@@ -13,9 +13,44 @@
 #endif
 
 #include "clientprops.h"
+#include "clientset.h"
+#include "manager/spatial.h"
+#include "manager/stack.h"
 
 #include <xcb/xcb.h>
 
+typedef struct session_t session_t;
+
+/**
+ * Maximum amount of unused frames kept in a session's frame pool.
+ */
+#define CLIENT_FRAMEPOOL_CAP 8
+
+/**
+ * A frame window along with its resize grips.
+ */
+typedef struct clientframe_t {
+    /** The frame window */
+    xcb_window_t frame;
+    /** Resize grips, as in `client_t` */
+    xcb_window_t grips[CLIENT_GRIP_COUNT];
+} clientframe_t;
+
+/**
+ * A bounded pool of unmapped frames, with their event masks and resize grips already set up, so that framing a new client only takes a reconfigure
+ * and a reparent. Frames of unmanaged clients are returned to the pool, and it is topped up while the session is idle.
+ */
+typedef struct clientframepool_t {
+    /** Pooled frames */
+    clientframe_t frames[CLIENT_FRAMEPOOL_CAP];
+    /** Amount of pooled frames */
+    uint32_t len;
+    /** Inner margin that pooled frames are laid out for (that of the most recently framed client) */
+    margin_t margin;
+    /** 1 once `margin` is known; the pool isn't filled before a client has been framed */
+    uint8_t ready;
+} clientframepool_t;
+
 /**
  * A structure representing a managed (i.e. reparented) client (X window pair).
  */
@@ -24,49 +59,87 @@ typedef struct client_t {
     xcb_window_t inner;
     /** The parent/frame window - rendered into and directly managed by awm. */
     xcb_window_t frame;
+    /** InputOnly resize grips on the frame's edges and corners, in the order of the grip roles (XCB_NONE where the frame margin is too thin) */
+    xcb_window_t grips[CLIENT_GRIP_COUNT];
 
     /** Client properties. */
     clientprops_t properties;
+
+    /** Position of the client in the session's stacking order. */
+    stacknode_t stack;
+    /** Id of the client's frame rectangle in the session's spatial index (or `SPATIAL_ID_NONE` if not indexed). */
+    uint32_t spatialid;
+    /** Index of the monitor the client is on in the session's monitor set (or `MONITORSET_INDEX_NONE`), updated when the client crosses onto another. */
+    uint32_t monitor;
+    /** 1 if a request needed to frame the client failed, in which case its frame isn't returned to the frame pool */
+    uint8_t framefailed;
 } client_t;
 
 /**
- * Deallocates memory reserved for the specified client.
+ * Deallocates memory reserved within the specified client. The client itself is owned by its client set (see `clientset_free_client()`).
  */
 void client_dealloc(
     client_t *const client
 );
 
 /**
- * Create a framed client to hold the given inner window - the window will be reparented under the new frame.
+ * Create a framed client to hold the given inner window with initial properties `props` - the window will be reparented under the new frame.
  */
 client_t client_init_framed(
-    xcb_connection_t *const con,
-    xcb_screen_t *const scr,
-    const xcb_window_t inner
+    session_t *const session,
+    const xcb_window_t inner,
+    const clientprops_t props
 );
 
 /**
- * Destroy the frame in the given client and reparent the inner window to root.
+ * Remove the frame from the given client and reparent the inner window to root. The frame is returned to the session's frame pool if there is room
+ * for it, and destroyed otherwise.
  */
 void client_frame_destroy(
-    xcb_connection_t *const con,
+    session_t *const session,
     client_t *const client,
     const xcb_window_t root
 );
 
 /**
- * Raise the specified client to the top of the stack.
+ * Top up the session's frame pool with new (unmapped) frames. This is meant to be called while the session is idle.
+ */
+void client_framepool_refill(
+    session_t *const session
+);
+
+/**
+ * Destroy every frame in the session's frame pool.
+ */
+void client_framepool_dealloc(
+    session_t *const session
+);
+
+/**
+ * Raise the specified client to the top of its stacking layer.
  */
 void client_raise(
-    xcb_connection_t *const con,
+    session_t *const session,
     client_t *const client
 );
 
 /**
- * Switch window focus to the given client.
+ * Switch window focus to the given client, according to its ICCCM input model. `time` is the timestamp of the event that caused the focus change
+ * (or `XCB_CURRENT_TIME` for clients that don't use WM_TAKE_FOCUS, as ICCCM forbids it in that message). Nothing is sent to the X server if the client is already focused. 'Globally Active' clients are only asked to take
+ * focus, so they are recorded as focused once their FocusIn arrives rather than here.
  */
 void client_focus(
-    xcb_connection_t *const con,
+    session_t *const session,
+    client_t *const client,
+    const xcb_timestamp_t time
+);
+
+/**
+ * Record `client` (which may be NULL) as the focused client, without moving the X input focus itself.
+ * This swaps button grabs between the previous and new focused clients and updates _NET_ACTIVE_WINDOW, if the focused client has changed.
+ */
+void client_set_focused(
+    session_t *const session,
     client_t *const client
 );
 
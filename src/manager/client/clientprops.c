@@ -8,6 +8,8 @@
 #include "clientprops.h"
 
 #include "manager/atoms.h"
+#include "manager/multihead/monitor.h"
+#include "manager/session.h"
 #include "util/genutil.h"
 #include "util/logging.h"
 #include "client.h"
@@ -16,17 +18,76 @@
 
 #include <string.h>
 
+/**
+ * Constrain (inner) position `pos` of `client`, assuming it has the (inner) size `extent`, so that the client stays reachable on the monitor it is
+ * moved onto (edges leading onto adjacent monitors are not constrained). `monidx` holds the index of the monitor the client was last on, and the
+ * index of the monitor it is moved onto is returned into it.
+ * Flags are returned into `flags` as documented for `clientprops_set_pos()`.
+ */
+static offset_t constrain_pos(
+    session_t *const session,
+    const client_t *const client,
+    const offset_t pos,
+    const extent_t extent,
+    uint32_t *const monidx,
+    uint8_t *const flags
+);
+
+/**
+ * Update the cached monitor index of `client`.
+ */
+static void set_monitor(
+    client_t *const client,
+    const uint32_t monitor
+);
+
+/**
+ * Constrain (inner) size `extent` of `client` to its size hints. Flags are returned into `flags` as documented for `clientprops_set_size()`.
+ */
+static extent_t constrain_size(
+    const client_t *const client,
+    const extent_t extent,
+    uint8_t *const flags
+);
+
+/**
+ * Send a synthetic ConfigureNotify event to the client, describing its current geometry in root coordinates.
+ */
+static void send_configure_notify(
+    session_t *const session,
+    const client_t *const client
+);
+
 void clientprops_dealloc(clientprops_t *const props) {
     free(props->name);
 }
 
-clientprops_t clientprops_init_all(xcb_connection_t *const con, const xcb_window_t win) {
-    xcb_get_property_cookie_t c_net_name, c_name, c_normalhints;
+uint8_t clientprops_init_all(session_t *const session, const xcb_window_t win, clientprops_t *const props) {
+    const clientprops_cookies_t cookies = clientprops_request_all(session, win);
+
+    return clientprops_collect_all(session, win, &cookies, props);
+}
+
+clientprops_cookies_t clientprops_request_all(session_t *const session, const xcb_window_t win) {
+    xcb_connection_t *const con = session->con;
+
+    clientprops_cookies_t cookies;
 
-#   define GETPROP_COOKIE(atom, llen) xcb_get_property(con, 0, win, atom, XCB_GET_PROPERTY_TYPE_ANY, 0, llen)
-        c_net_name = GETPROP_COOKIE(ATOMS__NET_WM_NAME, UINT32_MAX);
-        c_name = xcb_icccm_get_wm_name(con, win);
-        c_normalhints = xcb_icccm_get_wm_normal_hints(con, win);
+    cookies.geom = xcb_get_geometry(con, win);
+    cookies.net_name = xcb_get_property(con, 0, win, ATOMS__NET_WM_NAME, XCB_GET_PROPERTY_TYPE_ANY, 0, UINT32_MAX);
+    cookies.name = xcb_icccm_get_wm_name(con, win);
+    cookies.normalhints = xcb_icccm_get_wm_normal_hints(con, win);
+    cookies.hints = xcb_icccm_get_wm_hints(con, win);
+    cookies.protocols = xcb_icccm_get_wm_protocols(con, win, ATOMS_WM_PROTOCOLS);
+    cookies.synccounter = xcb_get_property(con, 0, win, ATOMS__NET_WM_SYNC_REQUEST_COUNTER, XCB_ATOM_CARDINAL, 0, 2);
+
+    return cookies;
+}
+
+uint8_t clientprops_collect_all(session_t *const session, const xcb_window_t win, const clientprops_cookies_t *const cookies,
+    clientprops_t *const props)
+{
+    xcb_connection_t *const con = session->con;
 
     client_t c;
     c.inner = win;
@@ -36,22 +97,59 @@ clientprops_t clientprops_init_all(xcb_connection_t *const con, const xcb_window
     c.properties.innermargin.bottom = 4;
     c.properties.innermargin.left = c.properties.innermargin.right = 4; // make sure left and right are equal
 
-    // get initial client name
-    // fallback to icccm if ewmh property is not available
-    if (!clientprops_update_net_name(&c, xcb_get_property_reply(con, c_net_name, NULL))) {
-        clientprops_update_name(&c, xcb_get_property_reply(con, c_name, NULL));
-    }
+    // no maximum size unless hinted otherwise
+    c.properties.maxsize.width = UINT32_MAX;
+    c.properties.maxsize.height = UINT32_MAX;
+
+    // clients that don't specify an input hint are assumed to want input
+    c.properties.input = 1;
 
-    // get initial geometry (update it with WM_NORMAL_HINTS in case of US/PS values)
-    xcb_get_geometry_reply_t *const geom = xcb_get_geometry_reply(con, xcb_get_geometry(con, win), NULL);
+    // get initial geometry first: if the window is gone then there is nothing else to do
+    xcb_get_geometry_reply_t *const geom = xcb_get_geometry_reply(con, cookies->geom, NULL);
+    if (!geom) {
+        clientprops_discard_all(session, cookies);
+        return 0;
+    }
     c.properties.rect.extent.width =  geom->width;
     c.properties.rect.extent.height = geom->height;
     c.properties.rect.offset.x = geom->x;
     c.properties.rect.offset.y = geom->y;
-    clientprops_update_normal_hints(con, &c, xcb_get_property_reply(con, c_normalhints, NULL), &c.properties.rect);
-
     free(geom);
-    return c.properties;
+
+    // get initial client name
+    // fallback to icccm if ewmh property is not available
+    if (!clientprops_update_net_name(&c, xcb_get_property_reply(con, cookies->net_name, NULL))) {
+        clientprops_update_name(&c, xcb_get_property_reply(con, cookies->name, NULL));
+    } else {
+        xcb_discard_reply(con, cookies->name.sequence);
+    }
+
+    // update geometry with WM_NORMAL_HINTS in case of US/PS values
+    // (if there is no reply, don't let the update query for the hints again)
+    xcb_get_property_reply_t *const hints = xcb_get_property_reply(con, cookies->normalhints, NULL);
+    if (hints) {
+        clientprops_update_normal_hints(session, &c, hints, &c.properties.rect);
+    }
+
+    // input model
+    clientprops_update_hints(&c, xcb_get_property_reply(con, cookies->hints, NULL));
+    clientprops_update_protocols(&c, xcb_get_property_reply(con, cookies->protocols, NULL));
+    clientprops_update_sync_counter(&c, xcb_get_property_reply(con, cookies->synccounter, NULL));
+
+    *props = c.properties;
+    return 1;
+}
+
+void clientprops_discard_all(session_t *const session, const clientprops_cookies_t *const cookies) {
+    xcb_connection_t *const con = session->con;
+
+    xcb_discard_reply(con, cookies->geom.sequence);
+    xcb_discard_reply(con, cookies->net_name.sequence);
+    xcb_discard_reply(con, cookies->name.sequence);
+    xcb_discard_reply(con, cookies->normalhints.sequence);
+    xcb_discard_reply(con, cookies->hints.sequence);
+    xcb_discard_reply(con, cookies->protocols.sequence);
+    xcb_discard_reply(con, cookies->synccounter.sequence);
 }
 
 uint8_t clientprops_update_net_name(client_t *const client, xcb_get_property_reply_t *reply) {
@@ -105,7 +203,9 @@ void clientprops_update_name(client_t *const client, xcb_get_property_reply_t *r
     free(reply);
 }
 
-void clientprops_update_normal_hints(xcb_connection_t *const con, client_t *const client, xcb_get_property_reply_t *reply, rect_t *geom) {
+void clientprops_update_normal_hints(session_t *const session, client_t *const client, xcb_get_property_reply_t *reply, rect_t *geom) {
+    xcb_connection_t *const con = session->con;
+
     const xcb_window_t win = client->inner;
     clientprops_t *const props = &client->properties;
 
@@ -184,50 +284,303 @@ void clientprops_update_normal_hints(xcb_connection_t *const con, client_t *cons
     if (geom) {
         *geom = updgeom;
     } else {
-        clientprops_set_size(con, client, updgeom.extent);
-        clientprops_set_pos(con, client, updgeom.offset);
+        clientprops_apply(session, client, updgeom);
+    }
+}
+
+void clientprops_update_hints(client_t *const client, xcb_get_property_reply_t *reply) {
+    clientprops_t *const props = &client->properties;
+
+    xcb_icccm_wm_hints_t hints;
+
+    // if there is no input hint, assume the client wants input
+    props->input = 1;
+
+    if (reply && xcb_icccm_get_wm_hints_from_reply(&hints, reply) && (hints.flags & XCB_ICCCM_WM_HINT_INPUT)) {
+        props->input = (hints.input != 0);
+    }
+
+    free(reply);
+}
+
+void clientprops_update_protocols(client_t *const client, xcb_get_property_reply_t *reply) {
+    clientprops_t *const props = &client->properties;
+
+    xcb_icccm_get_wm_protocols_reply_t protocols;
+
+    props->take_focus = 0;
+    props->sync_request = 0;
+
+    if (!reply || !xcb_icccm_get_wm_protocols_from_reply(reply, &protocols)) {
+        free(reply);
+        return;
+    }
+
+    for (uint32_t i = 0; i < protocols.atoms_len; i++) {
+        if (protocols.atoms[i] == ATOMS_WM_TAKE_FOCUS) {
+            props->take_focus = 1;
+        } else if (protocols.atoms[i] == ATOMS__NET_WM_SYNC_REQUEST) {
+            props->sync_request = 1;
+        }
+    }
+
+    // (this frees the reply)
+    xcb_icccm_get_wm_protocols_reply_wipe(&protocols);
+}
+
+void clientprops_update_sync_counter(client_t *const client, xcb_get_property_reply_t *reply) {
+    clientprops_t *const props = &client->properties;
+
+    props->synccounter = XCB_NONE;
+
+    // the first value is the basic counter; a second (extended) counter may follow, but only the basic one is used
+    if (reply && reply->type == XCB_ATOM_CARDINAL && reply->format == 32 && xcb_get_property_value_length(reply) >= 4) {
+        props->synccounter = *(xcb_sync_counter_t *)xcb_get_property_value(reply);
     }
+
+    free(reply);
 }
 
-uint8_t clientprops_set_pos(xcb_connection_t *const con, client_t *const client, const offset_t pos) {
-    const xcb_window_t frame = client->frame;
+uint8_t clientprops_set_pos(session_t *const session, client_t *const client, const offset_t pos) {
+    xcb_connection_t *const con = session->con;
 
-    const rect_t   rect =   client->properties.rect;
     const margin_t margin = client->properties.innermargin;
 
-    int32_t newx = pos.x,
-            newy = pos.y;
+    uint8_t flags;
+    uint32_t monitor = client->monitor;
+    const offset_t newpos = constrain_pos(session, client, pos, client->properties.rect.extent, &monitor, &flags);
 
-    // coordinates for constraints
-    const int32_t minx = min(30 - (int32_t)rect.extent.width, 0), // keep at least 30 x pixels of the client on the screen
-                  miny = margin.top; // keep top window decorations onscreen
+    set_monitor(client, monitor);
 
-    // TODO: constrain to monitor bounds if there are no adjacent monitors
-    if (newx < minx) newx = minx;
-    if (newy < miny) newy = miny;
+    // redundant move
+    if (newpos.x == client->properties.rect.offset.x && newpos.y == client->properties.rect.offset.y) {
+        return flags;
+    }
 
-    client->properties.rect.offset = (offset_t){ newx, newy };
+    client->properties.rect.offset = newpos;
 
-    const int32_t newfx = newx - margin.left,
-                  newfy = newy - margin.top;
     xcb_configure_window(
-        con, frame,
+        con, client->frame,
         XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y,
         (uint32_t []) {
-            newfx, newfy
+            newpos.x - margin.left, newpos.y - margin.top
         });
-    xcb_flush(con);
 
-    const uint8_t xc = (newx != minx),
-                  yc = (newy != miny);
-    return xc | (yc << 1);
+    // moving the frame doesn't send the client a real ConfigureNotify, so it is told about its new position instead (ICCCM 4.1.5)
+    send_configure_notify(session, client);
+    session_defer_flush(session);
+
+    clientprops_index(session, client);
+
+    return flags;
 }
 
-uint8_t clientprops_set_size(xcb_connection_t *const con, client_t *const client, const extent_t extent) {
-    const xcb_window_t inner = client->inner,
-                       frame = client->frame;
+uint8_t clientprops_set_size(session_t *const session, client_t *const client, const extent_t extent) {
+    xcb_connection_t *const con = session->con;
+
+    const margin_t margin = client->properties.innermargin;
+
+    uint8_t flags;
+    const extent_t newsize = constrain_size(client, extent, &flags);
+
+    // redundant resize
+    if (newsize.width == client->properties.rect.extent.width && newsize.height == client->properties.rect.extent.height) {
+        return flags;
+    }
 
-    const margin_t margin =   client->properties.innermargin;
+    client->properties.rect.extent = newsize;
+
+    xcb_configure_window(
+        con, client->frame,
+        XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+        (uint32_t []) {
+            newsize.width + margin.left + margin.right, newsize.height + margin.top + margin.bottom
+        });
+    xcb_configure_window(
+        con, client->inner,
+        XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+        (uint32_t []) {
+            newsize.width, newsize.height
+        });
+    session_defer_flush(session);
+
+    clientprops_index(session, client);
+
+    return flags;
+}
+
+uint8_t clientprops_apply(session_t *const session, client_t *const client, const rect_t rect) {
+    xcb_connection_t *const con = session->con;
+
+    const margin_t margin = client->properties.innermargin;
+    const rect_t cur = client->properties.rect;
+
+    // constrain the size first, as position constraints depend on it
+    uint8_t sizeflags, posflags;
+    uint32_t monitor = client->monitor;
+    const extent_t newsize = constrain_size(client, rect.extent, &sizeflags);
+    const offset_t newpos = constrain_pos(session, client, rect.offset, newsize, &monitor, &posflags);
+
+    set_monitor(client, monitor);
+
+    const uint8_t moved = (newpos.x != cur.offset.x || newpos.y != cur.offset.y),
+                  resized = (newsize.width != cur.extent.width || newsize.height != cur.extent.height);
+
+    client->properties.rect = (rect_t){ newsize, newpos };
+
+    if (resized) {
+        // one request for the frame (moving it at the same time if needed), and one for the inner window
+        uint16_t mask = XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT;
+        uint32_t values[4];
+        uint32_t c = 0;
+
+        if (moved) {
+            mask |= XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y;
+            values[c++] = newpos.x - margin.left;
+            values[c++] = newpos.y - margin.top;
+        }
+        values[c++] = newsize.width + margin.left + margin.right;
+        values[c++] = newsize.height + margin.top + margin.bottom;
+
+        xcb_configure_window(con, client->frame, mask, values);
+        xcb_configure_window(con, client->inner, XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
+            (uint32_t []) {
+                newsize.width, newsize.height
+            });
+    } else if (moved) {
+        // the inner window moves with its frame
+        xcb_configure_window(con, client->frame, XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y,
+            (uint32_t []) {
+                newpos.x - margin.left, newpos.y - margin.top
+            });
+    }
+
+    if (moved || resized) {
+        clientprops_index(session, client);
+    }
+
+    // the client only gets a real ConfigureNotify if its inner window was resized, otherwise it has to be told about its geometry (ICCCM 4.1.5)
+    if (!resized) {
+        send_configure_notify(session, client);
+    }
+
+    session_defer_flush(session);
+
+    return moved | (resized << 1);
+}
+
+rect_t clientprops_constrain(session_t *const session, const client_t *const client, const rect_t rect) {
+    uint8_t sizeflags, posflags;
+    uint32_t monitor = client->monitor;
+    const extent_t newsize = constrain_size(client, rect.extent, &sizeflags);
+    const offset_t newpos = constrain_pos(session, client, rect.offset, newsize, &monitor, &posflags);
+
+    return (rect_t){ newsize, newpos };
+}
+
+rect_t clientprops_frame_rect(const clientprops_t *const props) {
+    const rect_t rect = props->rect;
+    const margin_t margin = props->innermargin;
+
+    return (rect_t){
+        .extent = {
+            rect.extent.width  + margin.left + margin.right,
+            rect.extent.height + margin.top  + margin.bottom
+        },
+        .offset = {
+            rect.offset.x - (int32_t)margin.left,
+            rect.offset.y - (int32_t)margin.top
+        }
+    };
+}
+
+void clientprops_update_monitor(session_t *const session, client_t *const client) {
+    const rect_t framerect = clientprops_frame_rect(&client->properties);
+    const offset_t centre = {
+        framerect.offset.x + (int32_t)(framerect.extent.width / 2),
+        framerect.offset.y + (int32_t)(framerect.extent.height / 2)
+    };
+
+    client->monitor = monitorset_index_by_point(&session->monitorset, centre);
+}
+
+void clientprops_index(session_t *const session, client_t *const client) {
+    spatial_t *const spatial = &session->spatial;
+
+    const rect_t framerect = clientprops_frame_rect(&client->properties);
+
+    if (client->spatialid == SPATIAL_ID_NONE) {
+        client->spatialid = spatial_insert(spatial, SPATIAL_KIND_CLIENT, client, framerect);
+    } else {
+        spatial_update(spatial, client->spatialid, framerect);
+    }
+}
+
+static offset_t constrain_pos(session_t *const session, const client_t *const client, const offset_t pos, const extent_t extent,
+    uint32_t *const monidx, uint8_t *const flags)
+{
+    const monitorset_t *const monitorset = &session->monitorset;
+
+    const margin_t margin = client->properties.innermargin;
+
+    int32_t newx = pos.x,
+            newy = pos.y;
+
+    // the client is on the monitor that the centre of its frame is on (at the requested position)
+    const offset_t centre = {
+        pos.x - (int32_t)margin.left + (int32_t)((extent.width + margin.left + margin.right) / 2),
+        pos.y - (int32_t)margin.top + (int32_t)((extent.height + margin.top + margin.bottom) / 2)
+    };
+    *monidx = monitorset_track_point(monitorset, *monidx, centre);
+    const monitor_t *const monitor = monitorset_get(monitorset, *monidx);
+
+    // coordinates for constraints
+    int32_t minx, maxx, miny, maxy;
+
+    if (monitor) {
+        // keep at least 30 x pixels of the client and its top window decorations on the monitor, except on edges leading onto another monitor
+        const rect_t d = monitor->dims;
+        const int32_t right = d.offset.x + (int32_t)d.extent.width,
+                      bottom = d.offset.y + (int32_t)d.extent.height;
+        const offset_t edgept = { max(min(centre.x, right - 1), d.offset.x), max(min(centre.y, bottom - 1), d.offset.y) };
+
+        minx = d.offset.x + 30 - (int32_t)extent.width;
+        maxx = right - 30;
+        miny = d.offset.y + margin.top;
+        maxy = bottom - 30 + margin.top;
+
+        if (monitorset_index_at(monitorset, (offset_t){ d.offset.x - 1, edgept.y }) != MONITORSET_INDEX_NONE) minx = INT32_MIN;
+        if (monitorset_index_at(monitorset, (offset_t){ right, edgept.y }) != MONITORSET_INDEX_NONE)          maxx = INT32_MAX;
+        if (monitorset_index_at(monitorset, (offset_t){ edgept.x, d.offset.y - 1 }) != MONITORSET_INDEX_NONE) miny = INT32_MIN;
+        if (monitorset_index_at(monitorset, (offset_t){ edgept.x, bottom }) != MONITORSET_INDEX_NONE)         maxy = INT32_MAX;
+    } else {
+        // no known monitors, so only keep the client within reach of the top-left of the screen
+        minx = min(30 - (int32_t)extent.width, 0);
+        maxx = INT32_MAX;
+        miny = margin.top;
+        maxy = INT32_MAX;
+    }
+
+    if (newx < minx) newx = minx;
+    if (newx > maxx) newx = maxx;
+    if (newy < miny) newy = miny;
+    if (newy > maxy) newy = maxy;
+
+    const uint8_t xc = (newx == pos.x),
+                  yc = (newy == pos.y);
+    *flags = xc | (yc << 1);
+
+    return (offset_t){ newx, newy };
+}
+
+static void set_monitor(client_t *const client, const uint32_t monitor) {
+    if (monitor != client->monitor) {
+        LLOG("Client 0x%08x moved onto monitor %u", client->inner, monitor);
+        client->monitor = monitor;
+    }
+}
+
+static extent_t constrain_size(const client_t *const client, const extent_t extent, uint8_t *const flags) {
     const extent_t minsize =  client->properties.minsize,
                    maxsize =  client->properties.maxsize;
     const extent_t basesize = client->properties.basesize; // if minsize is not present, assume basesize instead
@@ -270,25 +623,31 @@ uint8_t clientprops_set_size(xcb_connection_t *const con, client_t *const client
         hc = 1;
     }
 
-    client->properties.rect.extent = (extent_t){ width, height };
-
-    uint32_t fwidth =  width + margin.left + margin.right,
-             fheight = height + margin.top + margin.bottom;
-    xcb_configure_window(
-        con, frame,
-        XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
-        (uint32_t []) {
-            fwidth, fheight
-        });
-    xcb_configure_window(
-        con, inner,
-        XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT,
-        (uint32_t []) {
-            width, height
-        });
-    xcb_flush(con);
-
     const uint8_t hitmaxwid = (width == maxwid),
                   hitmaxhei = (height == maxhei);
-    return wc | (hc << 1) | (hitmaxwid << 2) | (hitmaxhei << 3);
+    *flags = wc | (hc << 1) | (hitmaxwid << 2) | (hitmaxhei << 3);
+
+    return (extent_t){ width, height };
+}
+
+static void send_configure_notify(session_t *const session, const client_t *const client) {
+    xcb_connection_t *const con = session->con;
+
+    const rect_t rect = client->properties.rect;
+
+    xcb_configure_notify_event_t ev;
+    memset(&ev, 0, sizeof(xcb_configure_notify_event_t));
+
+    ev.response_type = XCB_CONFIGURE_NOTIFY;
+    ev.event = client->inner;
+    ev.window = client->inner;
+    ev.above_sibling = XCB_NONE;
+    ev.x = rect.offset.x;
+    ev.y = rect.offset.y;
+    ev.width = rect.extent.width;
+    ev.height = rect.extent.height;
+    ev.border_width = 0;
+    ev.override_redirect = 0;
+
+    xcb_send_event(con, 0, client->inner, XCB_EVENT_MASK_STRUCTURE_NOTIFY, (const char *)&ev);
 }
@@ -16,8 +16,10 @@
 #include "data/rect.h"
 
 #include <xcb/xcb.h>
+#include <xcb/sync.h>
 
 typedef struct client_t client_t;
+typedef struct session_t session_t;
 
 /**
  * A datastructure of properties of a managed client.
@@ -42,8 +44,38 @@ typedef struct clientprops_t {
 
     /** Buffer/margin between the frame and inner window */
     margin_t innermargin;
+
+    /** 1 if the client accepts input focus being set on it (the WM_HINTS input field; 1 if unspecified) */
+    uint8_t input;
+    /** 1 if the client participates in WM_TAKE_FOCUS (i.e. it is listed in WM_PROTOCOLS) */
+    uint8_t take_focus;
+
+    /** 1 if the client participates in _NET_WM_SYNC_REQUEST (i.e. it is listed in WM_PROTOCOLS) */
+    uint8_t sync_request;
+    /** XSync counter the client updates once it has handled a sync request (_NET_WM_SYNC_REQUEST_COUNTER), or XCB_NONE */
+    xcb_sync_counter_t synccounter;
 } clientprops_t;
 
+/**
+ * Cookies for the requests needed to initialise a client's properties, as returned by `clientprops_request_all()`.
+ */
+typedef struct clientprops_cookies_t {
+    /** GetGeometry of the window */
+    xcb_get_geometry_cookie_t geom;
+    /** _NET_WM_NAME property */
+    xcb_get_property_cookie_t net_name;
+    /** WM_NAME property */
+    xcb_get_property_cookie_t name;
+    /** WM_NORMAL_HINTS property */
+    xcb_get_property_cookie_t normalhints;
+    /** WM_HINTS property */
+    xcb_get_property_cookie_t hints;
+    /** WM_PROTOCOLS property */
+    xcb_get_property_cookie_t protocols;
+    /** _NET_WM_SYNC_REQUEST_COUNTER property */
+    xcb_get_property_cookie_t synccounter;
+} clientprops_cookies_t;
+
 /**
  * Frees memory reserved within the specified `clientprops_t` structure.
  */
@@ -52,13 +84,44 @@ void clientprops_dealloc(
 );
 
 /**
- * Get all relevant window properties on the given X window and relate them to the resulting clientprops_t structure.
+ * Get all relevant window properties on the given X window and relate them to the resulting clientprops_t structure. Returns 0 if this failed
+ * (e.g. the window no longer exists).
+ *
+ * This waits for replies; to initialise many clients at once, use `clientprops_request_all()` and `clientprops_collect_all()` instead.
+ */
+uint8_t clientprops_init_all(
+    session_t *const session,
+    const xcb_window_t win,
+    clientprops_t *const props
+);
+
+/**
+ * Send (but don't wait for) all requests needed to initialise the properties of X window `win`.
  */
-clientprops_t clientprops_init_all(
-    xcb_connection_t *const con,
+clientprops_cookies_t clientprops_request_all(
+    session_t *const session,
     const xcb_window_t win
 );
 
+/**
+ * Wait for the replies to requests sent with `clientprops_request_all()` and relate them to `props`. Returns 0 if this failed (e.g. the window no
+ * longer exists).
+ */
+uint8_t clientprops_collect_all(
+    session_t *const session,
+    const xcb_window_t win,
+    const clientprops_cookies_t *const cookies,
+    clientprops_t *const props
+);
+
+/**
+ * Discard the replies to requests sent with `clientprops_request_all()`.
+ */
+void clientprops_discard_all(
+    session_t *const session,
+    const clientprops_cookies_t *const cookies
+);
+
 /**
  * Update client properties struct based on the _NET_WM_NAME property specified via `reply`.
  * Note that the (heap-allocated) `reply` is guaranteed to be freed in this function.
@@ -88,18 +151,46 @@ void clientprops_update_name(
  * applied to the client as-is.
  */
 void clientprops_update_normal_hints(
-    xcb_connection_t *const con,
+    session_t *const session,
     client_t *const client,
     xcb_get_property_reply_t *reply,
     rect_t *geom
 );
 
 /**
- * Move the client to the given coordinates, assuming those are of the inner window. Returns 0 if no change occurred.
- * The return value is guaranteed to be a bit-mask. 0b01 -> x-pos changed; 0b10 -> y-pos changed.
+ * Update the client's input model based on the WM_HINTS property specified via `reply` (which may be NULL if the property was deleted).
+ * Note that the (heap-allocated) `reply` is guaranteed to be freed in this function.
+ */
+void clientprops_update_hints(
+    client_t *const client,
+    xcb_get_property_reply_t *reply
+);
+
+/**
+ * Update the client's input model based on the WM_PROTOCOLS property specified via `reply` (which may be NULL if the property was deleted).
+ * Note that the (heap-allocated) `reply` is guaranteed to be freed in this function.
+ */
+void clientprops_update_protocols(
+    client_t *const client,
+    xcb_get_property_reply_t *reply
+);
+
+/**
+ * Update the client's sync counter based on the _NET_WM_SYNC_REQUEST_COUNTER property specified via `reply` (which may be NULL if the property was
+ * deleted). Note that the (heap-allocated) `reply` is guaranteed to be freed in this function.
+ */
+void clientprops_update_sync_counter(
+    client_t *const client,
+    xcb_get_property_reply_t *reply
+);
+
+/**
+ * Move the client to the given coordinates, assuming those are of the inner window. The position is constrained so the client stays reachable
+ * on the monitor it is moved onto (edges leading onto adjacent monitors are not constrained). Returns 0 if the position was constrained on both axes.
+ * The return value is guaranteed to be a bit-mask. 0b01 -> x-pos applied as given; 0b10 -> y-pos applied as given.
  */
 uint8_t clientprops_set_pos(
-    xcb_connection_t *const con,
+    session_t *const session,
     client_t *const client,
     const offset_t pos
 );
@@ -110,11 +201,55 @@ uint8_t clientprops_set_pos(
  * are set, then the max dims for width or height respectively have been reached. Otherwise, minimum dims have been reached.
  */
 uint8_t clientprops_set_size(
-    xcb_connection_t *const con,
+    session_t *const session,
     client_t *const client,
     const extent_t extent
 );
 
+/**
+ * Move and resize the client to the given (inner) geometry in one transaction. Constraints are applied as by `clientprops_set_pos()` and
+ * `clientprops_set_size()`, and then only what actually changed is sent: a single frame move, or a frame resize (moving it too if needed) and an inner
+ * resize. If the inner window wasn't resized, a synthetic ConfigureNotify is sent to the client instead, as ICCCM requires.
+ * Returns a bit-mask: 0b01 -> moved; 0b10 -> resized.
+ */
+uint8_t clientprops_apply(
+    session_t *const session,
+    client_t *const client,
+    const rect_t rect
+);
+
+/**
+ * Returns (inner) geometry `rect` constrained as it would be by `clientprops_apply()`, without applying it to the client.
+ */
+rect_t clientprops_constrain(
+    session_t *const session,
+    const client_t *const client,
+    const rect_t rect
+);
+
+/**
+ * Get the on-screen rectangle of the client's frame, i.e. its inner geometry grown by the frame margin.
+ */
+rect_t clientprops_frame_rect(
+    const clientprops_t *const props
+);
+
+/**
+ * Recompute which monitor the client is on from its current geometry (e.g. after the monitor layout has changed).
+ */
+void clientprops_update_monitor(
+    session_t *const session,
+    client_t *const client
+);
+
+/**
+ * Bring the client's entry in the session's spatial index in line with its current geometry, adding it to the index if it isn't there yet.
+ */
+void clientprops_index(
+    session_t *const session,
+    client_t *const client
+);
+
 #ifdef __cplusplus
     }
 #endif
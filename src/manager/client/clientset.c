@@ -12,58 +12,265 @@
 
 #include <string.h>
 
-static void free_client_cb(
-    void *const client
+#define INDEX_MASK (((uint32_t)1 << CLIENT_HANDLE_INDEX_BITS) - 1)
+#define GEN_MASK (((uint32_t)1 << CLIENT_HANDLE_GEN_BITS) - 1)
+#define HANDLE_MASK (((uint32_t)1 << (CLIENT_HANDLE_INDEX_BITS + CLIENT_HANDLE_GEN_BITS)) - 1)
+
+/**
+ * A slot in a client set's slab.
+ */
+typedef struct clientset_slot_t {
+    /** The client (must be the first member, so a client pointer can be converted back to its slot) */
+    client_t client;
+    /** Index of this slot */
+    uint32_t index;
+    /** Index of the next free slot if this slot is free (UINT32_MAX if this is the last one) */
+    uint32_t nextfree;
+    /** Generation of this slot, changed whenever its client is freed (never 0) */
+    uint16_t gen;
+    /** 1 if the slot holds a client */
+    uint8_t used;
+} clientset_slot_t;
+
+/**
+ * Get the slot at index `i`.
+ */
+static clientset_slot_t *slot_at(
+    const clientset_t *const set,
+    const uint32_t i
+);
+
+/**
+ * Allocate another chunk of slots and put them on the free list. Return 0 if there is an error.
+ */
+static uint8_t slab_grow(
+    clientset_t *const set
+);
+
+/**
+ * Encode a client handle and role into a registry value.
+ */
+static void *ref_encode(
+    const clienthandle_t handle,
+    const clientrole_t role
+);
+
+/**
+ * Decode a registry value into a client handle and role, and resolve the client.
+ */
+static clientref_t ref_decode(
+    const clientset_t *const set,
+    void *const val
 );
 
 clientset_t clientset_init(void) {
     clientset_t set;
-    set.byinner_ht = htable_u32_new();
-    set.byframe_ht = htable_u32_new();
+    set.bywin_ht = htable_u32_new();
+
+    set.chunks = NULL;
+    set.chunkn = 0;
+    set.freehead = UINT32_MAX;
+    set.len = 0;
 
     return set;
 }
 
 void clientset_dealloc(clientset_t *const set) {
-    htable_u32_t
-        *const iht = set->byinner_ht,
-        *const fht = set->byframe_ht;
+    // htable gives errors if the table is NULL
+    if (set->bywin_ht) {
+        htable_u32_free(set->bywin_ht, NULL);
+    }
+
+    // free remaining clients, then the slab itself
+    for (uint32_t c = 0; c < set->chunkn; c++) {
+        clientset_slot_t *const chunk = set->chunks[c];
 
-    // htable gives errors if either table is NULL
-    if (iht && fht) {
-        htable_u32_free(iht, free_client_cb);
-        htable_u32_free(fht, NULL); // avoid double-free errors on clients
+        for (uint32_t i = 0; i < CLIENTSET_SLAB_CHUNK; i++) {
+            if (chunk[i].used) {
+                client_dealloc(&chunk[i].client);
+            }
+        }
+        free(chunk);
     }
+    free(set->chunks);
 
     memset(set, 0, sizeof(clientset_t));
 }
 
+client_t *clientset_alloc_client(clientset_t *const set) {
+    if (set->freehead == UINT32_MAX && !slab_grow(set)) {
+        return NULL;
+    }
+
+    clientset_slot_t *const slot = slot_at(set, set->freehead);
+
+    set->freehead = slot->nextfree;
+    set->len++;
+
+    slot->used = 1;
+    memset(&slot->client, 0, sizeof(client_t));
+
+    return &slot->client;
+}
+
+void clientset_free_client(clientset_t *const set, client_t *const client) {
+    clientset_slot_t *const slot = (clientset_slot_t *)client;
+
+    client_dealloc(client);
+
+    // invalidate existing handles (skipping generation 0, so a handle is never CLIENT_HANDLE_NONE)
+    slot->gen = (slot->gen + 1) & GEN_MASK;
+    if (!slot->gen) {
+        slot->gen = 1;
+    }
+    slot->used = 0;
+
+    // slots are reused last-in first-out, so the most recently used (i.e. cached) memory is reused first
+    slot->nextfree = set->freehead;
+    set->freehead = slot->index;
+    set->len--;
+}
+
+clienthandle_t clientset_handle(const clientset_t *const set, const client_t *const client) {
+    const clientset_slot_t *const slot = (const clientset_slot_t *)client;
+
+    // suppress unused parameter
+    (void)set;
+
+    return slot->index | ((uint32_t)slot->gen << CLIENT_HANDLE_INDEX_BITS);
+}
+
+client_t *clientset_get(const clientset_t *const set, const clienthandle_t handle) {
+    const uint32_t i = handle & INDEX_MASK;
+    const uint32_t gen = (handle >> CLIENT_HANDLE_INDEX_BITS) & GEN_MASK;
+
+    if (i / CLIENTSET_SLAB_CHUNK >= set->chunkn) {
+        return NULL;
+    }
+
+    clientset_slot_t *const slot = slot_at(set, i);
+    if (!slot->used || slot->gen != gen) {
+        // stale handle
+        return NULL;
+    }
+
+    return &slot->client;
+}
+
 uint8_t clientset_push(clientset_t *const set, client_t *const client) {
-    htable_u32_t
-        *const iht = set->byinner_ht,
-        *const fht = set->byframe_ht;
+    if (!clientset_register(set, client->inner, client, CLIENT_ROLE_INNER)) {
+        return 0;
+    }
+    if (!clientset_register(set, client->frame, client, CLIENT_ROLE_FRAME)) {
+        clientset_unregister(set, client->inner);
+        return 0;
+    }
+
+    // grips too thin to exist are XCB_NONE
+    for (uint32_t i = 0; i < CLIENT_GRIP_COUNT; i++) {
+        if (client->grips[i] != XCB_NONE && !clientset_register(set, client->grips[i], client, CLIENT_ROLE_GRIP(i))) {
+            while (i--) {
+                if (client->grips[i] != XCB_NONE) {
+                    clientset_unregister(set, client->grips[i]);
+                }
+            }
+            clientset_unregister(set, client->inner);
+            clientset_unregister(set, client->frame);
+            return 0;
+        }
+    }
 
-    const uint32_t
-        ikey = (uint32_t)client->inner,
-        fkey = (uint32_t)client->frame;
+    return 1;
+}
 
-    // adding the same client to separate htables to index by both child and parent windows
-    htable_err_t err =
-        htable_u32_set(iht, ikey, (void *)client) |
-        htable_u32_set(fht, fkey, (void *)client);
+void clientset_remove(clientset_t *const set, client_t *const client) {
+    clientset_unregister(set, client->inner);
+    clientset_unregister(set, client->frame);
 
-    if (!err) {
-        // no errors
-        return 1;
+    for (uint32_t i = 0; i < CLIENT_GRIP_COUNT; i++) {
+        if (client->grips[i] != XCB_NONE) {
+            clientset_unregister(set, client->grips[i]);
+        }
     }
+}
 
-    if (err & HTE_EXIST) {
-        LERR("Failed to add client to set: inner (0x%08x) or frame (0x%08x) key already exists in the htable", ikey, fkey);
+uint8_t clientset_register(clientset_t *const set, const xcb_window_t win, client_t *const client, const clientrole_t role) {
+    if (htable_u32_set(set->bywin_ht, (uint32_t)win, ref_encode(clientset_handle(set, client), role)) == HTE_EXIST) {
+        LERR("Failed to add window 0x%08x to client set: key already exists in the htable", win);
+        return 0;
     }
 
-    return 0;
+    return 1;
+}
+
+void clientset_unregister(clientset_t *const set, const xcb_window_t win) {
+    htable_u32_pop(set->bywin_ht, (uint32_t)win, NULL);
+}
+
+clientref_t clientset_find(const clientset_t *const set, const xcb_window_t win) {
+    return ref_decode(set, htable_u32_get(set->bywin_ht, (uint32_t)win, NULL));
 }
 
-static void free_client_cb(void *const client) {
-    client_dealloc((client_t *const)client);
+client_t *clientset_find_role(const clientset_t *const set, const xcb_window_t win, const clientrole_t role) {
+    const clientref_t ref = clientset_find(set, win);
+
+    return (ref.role == role) ? ref.client : NULL;
+}
+
+static clientset_slot_t *slot_at(const clientset_t *const set, const uint32_t i) {
+    return &set->chunks[i / CLIENTSET_SLAB_CHUNK][i % CLIENTSET_SLAB_CHUNK];
+}
+
+static uint8_t slab_grow(clientset_t *const set) {
+    const uint32_t first = set->chunkn * CLIENTSET_SLAB_CHUNK;
+
+    if (first + CLIENTSET_SLAB_CHUNK > INDEX_MASK + 1) {
+        LERR("Client set is full (%u clients)", set->len);
+        return 0;
+    }
+
+    clientset_slot_t **const chunks = realloc(set->chunks, sizeof(clientset_slot_t *) * (set->chunkn + 1));
+    if (!chunks) {
+        LERR("realloc() fault");
+        return 0;
+    }
+    set->chunks = chunks;
+
+    clientset_slot_t *const chunk = calloc(CLIENTSET_SLAB_CHUNK, sizeof(clientset_slot_t));
+    if (!chunk) {
+        LERR("calloc() fault");
+        return 0;
+    }
+    set->chunks[set->chunkn++] = chunk;
+
+    // link new slots into the free list, in order
+    for (uint32_t i = 0; i < CLIENTSET_SLAB_CHUNK; i++) {
+        chunk[i].index = first + i;
+        chunk[i].nextfree = (i + 1 < CLIENTSET_SLAB_CHUNK) ? first + i + 1 : set->freehead;
+        chunk[i].gen = 1;
+        chunk[i].used = 0;
+    }
+    set->freehead = first;
+
+    return 1;
+}
+
+static void *ref_encode(const clienthandle_t handle, const clientrole_t role) {
+    return (void *)(uintptr_t)(handle | ((uint32_t)role << (CLIENT_HANDLE_INDEX_BITS + CLIENT_HANDLE_GEN_BITS)));
+}
+
+static clientref_t ref_decode(const clientset_t *const set, void *const val) {
+    const uint32_t v = (uint32_t)(uintptr_t)val;
+    const clienthandle_t handle = v & HANDLE_MASK;
+
+    if (!v) {
+        // not registered
+        return (clientref_t){ NULL, CLIENT_HANDLE_NONE, CLIENT_ROLE_INNER };
+    }
+
+    return (clientref_t){
+        .client = clientset_get(set, handle),
+        .handle = handle,
+        .role = (clientrole_t)(v >> (CLIENT_HANDLE_INDEX_BITS + CLIENT_HANDLE_GEN_BITS))
+    };
 }
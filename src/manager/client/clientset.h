@@ -14,16 +14,107 @@
 
 #include "htable/htable.h"
 
+#include <xcb/xcb.h>
+
 typedef struct client_t client_t;
 
+/**
+ * The role of a managed X window within its client.
+ */
+typedef enum clientrole_t {
+    /** The inner (application) window */
+    CLIENT_ROLE_INNER = 0,
+    /** The frame window */
+    CLIENT_ROLE_FRAME = 1,
+
+    /** Resize grips on the frame's edges and corners, in the same order as a client's `grips` */
+    CLIENT_ROLE_GRIP_LEFT = 2,
+    CLIENT_ROLE_GRIP_RIGHT,
+    CLIENT_ROLE_GRIP_TOP,
+    CLIENT_ROLE_GRIP_BOTTOM,
+    CLIENT_ROLE_GRIP_TOPLEFT,
+    CLIENT_ROLE_GRIP_TOPRIGHT,
+    CLIENT_ROLE_GRIP_BOTTOMLEFT,
+    CLIENT_ROLE_GRIP_BOTTOMRIGHT,
+} clientrole_t;
+
+/**
+ * Amount of resize grips on each frame (one per edge and corner).
+ */
+#define CLIENT_GRIP_COUNT 8
+
+/**
+ * Get the role of the `i`th resize grip of a frame.
+ */
+#define CLIENT_ROLE_GRIP(i) ((clientrole_t)(CLIENT_ROLE_GRIP_LEFT + (i)))
+
+/**
+ * Evaluates to 1 if `role` is one of the resize grip roles.
+ */
+#define CLIENT_ROLE_IS_GRIP(role) ((role) >= CLIENT_ROLE_GRIP_LEFT && (role) < CLIENT_ROLE_GRIP_LEFT + CLIENT_GRIP_COUNT)
+
+/**
+ * Generational handle to a client in a client set. The low `CLIENT_HANDLE_INDEX_BITS` bits index the client's slot, and the following
+ * `CLIENT_HANDLE_GEN_BITS` bits hold the slot's generation, which changes every time the slot is freed - so handles to freed clients are detected as
+ * stale rather than referring to whichever client reuses the slot.
+ */
+typedef uint32_t clienthandle_t;
+
+/**
+ * Amount of bits of a client handle used for the slot index (this limits the maximum amount of clients).
+ */
+#define CLIENT_HANDLE_INDEX_BITS 16
+/**
+ * Amount of bits of a client handle used for the slot generation.
+ */
+#define CLIENT_HANDLE_GEN_BITS 12
+/**
+ * Amount of bits above a client handle used to store the window role in registry values.
+ */
+#define CLIENTSET_ROLE_BITS (32 - CLIENT_HANDLE_INDEX_BITS - CLIENT_HANDLE_GEN_BITS)
+
+/**
+ * A handle that never refers to a client (generations start at 1).
+ */
+#define CLIENT_HANDLE_NONE 0
+
+/**
+ * Amount of client slots allocated at a time when the slab runs out of free slots.
+ */
+#define CLIENTSET_SLAB_CHUNK 64
+
+/**
+ * A reference from a managed X window to its client, as stored in the client set's window registry.
+ */
+typedef struct clientref_t {
+    /** The client owning the window, or NULL if the window is not managed (or its client has since been freed) */
+    client_t *client;
+    /** Handle of `client` */
+    clienthandle_t handle;
+    /** The role of the window within `client` */
+    clientrole_t role;
+} clientref_t;
+
+typedef struct clientset_slot_t clientset_slot_t;
+
 /**
  * A structure containing a set of references to clients.
+ *
+ * Clients themselves are also owned by the set: they are allocated from a slab of fixed-size slots, which are kept on a free list when not in use
+ * so that managing and unmanaging windows doesn't allocate once the slab has grown to fit the session's peak amount of clients.
  */
 typedef struct clientset_t {
-    /** Table of clients in the set, indexed by their inner handles */
-    htable_u32_t *byinner_ht;
-    /** Table of clients in the set, indexed by their frame handles */
-    htable_u32_t *byframe_ht;
+    /** Registry of every managed X window (inner, frame, etc), mapped to its client handle and role. */
+    htable_u32_t *bywin_ht;
+
+    /** Chunks of `CLIENTSET_SLAB_CHUNK` slots (chunks are never moved, so client pointers remain valid until the client is freed) */
+    clientset_slot_t **chunks;
+    /** Amount of chunks in `chunks` */
+    uint32_t chunkn;
+    /** Index of the first free slot, or UINT32_MAX if there are none */
+    uint32_t freehead;
+    /** Amount of clients currently allocated */
+    uint32_t len;
 } clientset_t;
 
 /**
@@ -32,20 +123,95 @@ typedef struct clientset_t {
 clientset_t clientset_init(void);
 
 /**
- * Free memory allocated for the given clientset `set`.
+ * Free memory allocated for the given clientset `set`, including all clients in it.
  */
 void clientset_dealloc(
     clientset_t *const set
 );
 
 /**
- * Add `client` to client store `set`. Return 0 if there is an error.
+ * Allocate a (zeroed) client from the set's slab. It is not registered in the set until it is pushed. Returns NULL if there is an error.
+ */
+client_t *clientset_alloc_client(
+    clientset_t *const set
+);
+
+/**
+ * Deallocate `client` (with `client_dealloc()`) and return its slot to the set's slab. Existing handles to it become stale. The client should
+ * already have been removed from the set.
+ */
+void clientset_free_client(
+    clientset_t *const set,
+    client_t *const client
+);
+
+/**
+ * Get the handle of `client`, which must have been allocated from `set`.
+ */
+clienthandle_t clientset_handle(
+    const clientset_t *const set,
+    const client_t *const client
+);
+
+/**
+ * Get the client referred to by `handle`, or NULL if the handle is stale (i.e. the client has been freed).
+ */
+client_t *clientset_get(
+    const clientset_t *const set,
+    const clienthandle_t handle
+);
+
+/**
+ * Add `client` to client store `set`, registering its inner and frame windows (and the frame's resize grips). Return 0 if there is an error.
  */
 uint8_t clientset_push(
     clientset_t *const set,
     client_t *const client
 );
 
+/**
+ * Remove `client` from client store `set`, unregistering all of its windows. The client is not freed.
+ */
+void clientset_remove(
+    clientset_t *const set,
+    client_t *const client
+);
+
+/**
+ * Register X window `win` as having role `role` in `client`. Return 0 if there is an error (e.g. the window is already registered).
+ */
+uint8_t clientset_register(
+    clientset_t *const set,
+    const xcb_window_t win,
+    client_t *const client,
+    const clientrole_t role
+);
+
+/**
+ * Unregister X window `win` from the set.
+ */
+void clientset_unregister(
+    clientset_t *const set,
+    const xcb_window_t win
+);
+
+/**
+ * Look up the client and role of X window `win`. The returned client is NULL if the window isn't managed.
+ */
+clientref_t clientset_find(
+    const clientset_t *const set,
+    const xcb_window_t win
+);
+
+/**
+ * Get the client owning X window `win`, but only if `win` has role `role` within it (otherwise, or if not managed, NULL is returned).
+ */
+client_t *clientset_find_role(
+    const clientset_t *const set,
+    const xcb_window_t win,
+    const clientrole_t role
+);
+
 #ifdef __cplusplus
     }
 #endif
@@ -8,10 +8,30 @@
 #include "drag.h"
 
 #include "manager/client/client.h"
+#include "manager/atoms.h"
+#include "manager/multihead/monitor.h"
 #include "manager/session.h"
 #include "util/genutil.h"
+#include "util/logging.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <xcb/xcbext.h>
+
+/**
+ * Refresh rate (in millihertz) assumed when pacing drag updates on a monitor whose refresh rate is unknown.
+ */
+#define DRAG_FALLBACK_REFRESH 60000
+
+/**
+ * Time to wait for a client to answer a _NET_WM_SYNC_REQUEST before resizes are no longer synchronised with it, in nanoseconds.
+ */
+#define DRAG_SYNC_TIMEOUT_NS (200 * 1000000ULL)
+
+/**
+ * Thickness of the outline drawn during outline drags, in pixels.
+ */
+#define DRAG_OUTLINE_WIDTH 2
 
 typedef enum resize_side_t {
     RESIZE_NONE     = 0x00,
@@ -21,235 +41,800 @@ typedef enum resize_side_t {
     RESIZE_BOTTOM   = 0x08,
 } resize_side_t;
 
-static uint8_t get_resize_side_mask(
-    offset_t ptrpos,
-    offset_t innerpos,
-    extent_t innersize,
-    margin_t framemarg
+/**
+ * Sides resized by dragging each resize grip, in the order of the grip roles.
+ */
+static const uint8_t grip_sides[CLIENT_GRIP_COUNT] = {
+    RESIZE_LEFT, RESIZE_RIGHT, RESIZE_TOP, RESIZE_BOTTOM,
+    RESIZE_TOP | RESIZE_LEFT, RESIZE_TOP | RESIZE_RIGHT, RESIZE_BOTTOM | RESIZE_LEFT, RESIZE_BOTTOM | RESIZE_RIGHT
+};
+
+/**
+ * Release everything held by the drag in progress (grab, timers, alarm, outline) and mark it inactive. No geometry is applied.
+ */
+static void drag_stop(
+    session_t *const session
 );
 
-static void move_and_wait(
-    xcb_connection_t *const con,
+/**
+ * Create the (unmapped) outline windows for an outline drag. If outline dragging is disabled in the session config, no windows are created.
+ */
+static drag_outline_t outline_init(
+    session_t *const session
+);
+
+/**
+ * Destroy the given outline's windows.
+ */
+static void outline_dealloc(
     session_t *const session,
-    client_t *const client,
-    const eventhandler_t handler,
-    offset_t ptrpos,
-    offset_t innerpos
+    drag_outline_t *const outline
+);
+
+/**
+ * Draw the outline around (inner) geometry `rect` of `client`, mapping it if it isn't shown yet.
+ */
+static void outline_show(
+    session_t *const session,
+    drag_outline_t *const outline,
+    const client_t *const client,
+    const rect_t rect
+);
+
+/**
+ * Set up pacing for dragging `client`. If pacing is disabled in the session config, the pacer will let every commit through.
+ */
+static void pacer_start(
+    session_t *const session,
+    drag_pacer_t *const pacer,
+    const client_t *const client
+);
+
+/**
+ * Returns 1 if geometry may be committed now. If so, and the drag is paced, the pacing timer is started so the next commit will only be allowed once
+ * it has expired.
+ */
+static uint8_t pacer_try_commit(
+    drag_pacer_t *const pacer
+);
+
+/**
+ * Event loop callback: the pacing timer expired.
+ */
+static void pacer_cb(
+    evloop_source_t *const src,
+    void *const data
+);
+
+/**
+ * Set up resize synchronisation for `drag`. Resizes are only synchronised if the client supports _NET_WM_SYNC_REQUEST and XSync is available;
+ * otherwise (and for moves and outline drags) the syncer lets every commit through.
+ */
+static void syncer_start(
+    session_t *const session,
+    drag_syncer_t *const syncer,
+    const drag_t *const drag
+);
+
+/**
+ * Stop synchronising resizes for the rest of the drag, destroying the syncer's alarm.
+ */
+static void syncer_stop(
+    session_t *const session,
+    drag_syncer_t *const syncer
 );
 
-static void resize_and_wait(
-    xcb_connection_t *const con,
+/**
+ * Send a sync request for the next resize of `client`, and set the syncer's alarm to its counter value. Synchronisation is stopped if the client's
+ * counter couldn't be queried.
+ */
+static void syncer_request(
     session_t *const session,
     client_t *const client,
-    const eventhandler_t handler,
-    offset_t ptrpos,
-    offset_t innerpos,
-    extent_t innersize,
-    uint8_t side
+    drag_syncer_t *const syncer,
+    const xcb_timestamp_t time
 );
 
-void drag_start_and_wait(session_t *const session, client_t *const client, const eventhandler_t handler) {
-    xcb_connection_t *const con = session->con;
-    const xcb_window_t root = session->root;
+/**
+ * Event loop callback: a sync request wasn't answered in time.
+ */
+static void syncer_cb(
+    evloop_source_t *const src,
+    void *const data
+);
 
-    xcb_grab_pointer_reply_t *greply = NULL;
-    xcb_query_pointer_reply_t *qreply = NULL;
+/**
+ * Commit pending geometry of `drag` if the pacer and syncer allow it, sending a sync request first if resizes are synchronised.
+ */
+static void drag_try_commit(
+    session_t *const session,
+    drag_t *const drag
+);
 
-    const margin_t framemarg = client->properties.innermargin;
-    const rect_t rect = client->properties.rect;
-    offset_t ptrpos;
+/**
+ * Commit pending geometry of `drag` regardless of the pacer, preceded by a sync request if resizes are synchronised and the commit will actually
+ * change the client's size.
+ */
+static void drag_commit_synced(
+    session_t *const session,
+    drag_t *const drag
+);
 
-    uint8_t side;
+/**
+ * Apply client geometry from the current pointer position of a drag, either moving or resizing the client (or its outline, for outline drags).
+ */
+static void drag_commit(
+    session_t *const session,
+    drag_t *const drag
+);
 
-    // get pointer starting position
-    qreply = xcb_query_pointer_reply(con, xcb_query_pointer(con, root), NULL);
-    if (!qreply) {
-        goto out;
+/**
+ * Get the offset that snaps the dragged client's frame, whose left and right edges are at `x0` and `x1` and top and bottom edges at `y0` and `y1`,
+ * onto the nearest edges of other clients and monitors within the configured snap threshold. Only edges on the sides in mask `sides` are snapped.
+ * As snapping works in both directions, this also makes edges resist being dragged past each other until the pointer overshoots by the threshold.
+ */
+static offset_t snap_offset(
+    session_t *const session,
+    const drag_t *const drag,
+    const int32_t x0,
+    const int32_t x1,
+    const int32_t y0,
+    const int32_t y1,
+    const uint8_t sides
+);
+
+/**
+ * Returns the (inner, snapped) position a move drag has moved the client to.
+ */
+static offset_t move_target(
+    session_t *const session,
+    const drag_t *const drag
+);
+
+/**
+ * Returns the (inner, snapped but unconstrained) size a resize drag has resized the client to.
+ */
+static extent_t resize_target(
+    session_t *const session,
+    const drag_t *const drag
+);
+
+/**
+ * Returns the (inner) position of a client resized to `size`, so that the edges opposite to those being dragged stay where they were.
+ */
+static offset_t resize_anchor(
+    const drag_t *const drag,
+    const extent_t size
+);
+
+/**
+ * Returns the constrained (inner) geometry the client would have if the drag was committed, without applying it.
+ */
+static rect_t outline_target(
+    session_t *const session,
+    const drag_t *const drag
+);
+
+static void move_commit(
+    session_t *const session,
+    const drag_t *const drag
+);
+
+static void resize_commit(
+    session_t *const session,
+    const drag_t *const drag
+);
+
+uint8_t drag_init(session_t *const session) {
+    drag_t *const drag = &session->drag;
+
+    memset(drag, 0, sizeof(drag_t));
+    drag->syncer.alarm = XCB_NONE;
+
+    const uint8_t pacerok = evloop_timer_init(&session->loop, &drag->pacer.timer, pacer_cb, session);
+    const uint8_t syncerok = evloop_timer_init(&session->loop, &drag->syncer.timer, syncer_cb, session);
+
+    return pacerok && syncerok;
+}
+
+void drag_dealloc(session_t *const session) {
+    drag_t *const drag = &session->drag;
+
+    drag_end(session);
+
+    evloop_timer_dealloc(&session->loop, &drag->pacer.timer);
+    evloop_timer_dealloc(&session->loop, &drag->syncer.timer);
+}
+
+void drag_start(session_t *const session, client_t *const client, const clientrole_t role, const xcb_button_press_event_t *const ev) {
+    xcb_connection_t *const con = session->con;
+    drag_t *const drag = &session->drag;
+
+    const rect_t rect = client->properties.rect;
+
+    if (drag->active) {
+        drag_end(session);
     }
-    ptrpos = (offset_t){
-        qreply->root_x,
-        qreply->root_y
-    };
 
-    // determine if the window is being dragged at the edge, and if so which one(s)
-    side = get_resize_side_mask(ptrpos, rect.offset, rect.extent, framemarg);
+    // the press already tells us where the pointer started
+    drag->client = client;
+    drag->ptrstart = (offset_t){ ev->root_x, ev->root_y };
+    drag->start = rect;
+    drag->target = rect;
+    drag->ptr = drag->ptrstart;
+    drag->time = ev->time;
+    drag->dirty = 0;
 
-    // grab pointer
-    greply = xcb_grab_pointer_reply(con, xcb_grab_pointer(con, 0, root,
+    // the server already worked out which edge (if any) was pressed, by which window recieved the press
+    drag->side = CLIENT_ROLE_IS_GRIP(role) ? grip_sides[role - CLIENT_ROLE_GRIP_LEFT] : RESIZE_NONE;
+
+    // grab pointer (the reply is checked once it arrives, see drag_check_grab())
+    drag->grabseq = xcb_grab_pointer(con, 0, session->root,
         XCB_EVENT_MASK_BUTTON_MOTION | XCB_EVENT_MASK_BUTTON_PRESS | XCB_EVENT_MASK_BUTTON_RELEASE,
         XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC,
-        XCB_NONE, XCB_NONE, XCB_CURRENT_TIME),
-        NULL);
-    if (!greply || greply->status != XCB_GRAB_STATUS_SUCCESS) {
-        goto out;
+        XCB_NONE, XCB_NONE, ev->time).sequence;
+    drag->grabpending = 1;
+
+    drag->outline = outline_init(session);
+    pacer_start(session, &drag->pacer, client);
+    syncer_start(session, &drag->syncer, drag);
+
+    drag->active = 1;
+
+    session_defer_flush(session);
+}
+
+void drag_end(session_t *const session) {
+    drag_t *const drag = &session->drag;
+    client_t *const client = drag->client;
+
+    if (!drag->active) {
+        return;
     }
 
-    if (side == RESIZE_NONE) {
-        move_and_wait(con, session, client, handler, ptrpos, rect.offset);
-    } else {
-        resize_and_wait(con, session, client, handler, ptrpos, rect.offset, rect.extent, side);
+    // apply the final pointer position if it was held back by pacing or syncing
+    if (drag->dirty) {
+        drag_commit_synced(session, drag);
     }
 
+    // outline drags are applied in one geometry transaction once they end, so the client is only reconfigured once
+    if (drag->outline.strips[0] != XCB_NONE) {
+        const rect_t cur = client->properties.rect;
+        const rect_t target = drag->target;
+
+        if (target.offset.x != cur.offset.x || target.offset.y != cur.offset.y ||
+            target.extent.width != cur.extent.width || target.extent.height != cur.extent.height)
+        {
+            clientprops_apply(session, client, target);
+        }
+    }
+
+    drag_stop(session);
+}
+
+void drag_forget_client(session_t *const session, const client_t *const client) {
+    drag_t *const drag = &session->drag;
+
+    if (!drag->active || drag->client != client) {
+        return;
+    }
+
+    LLOG("Dragged client 0x%08x was unmanaged; abandoning drag", client->inner);
+
+    drag_stop(session);
+}
+
+void drag_handle_motion(session_t *const session, const xcb_motion_notify_event_t *const ev) {
+    drag_t *const drag = &session->drag;
+
+    if (!drag->active) {
+        return;
+    }
+
+    drag->ptr = (offset_t){ ev->root_x, ev->root_y };
+    drag->time = ev->time;
+    drag->dirty = 1;
+
+    drag_try_commit(session, drag);
+}
+
+void drag_handle_alarm(session_t *const session, const xcb_sync_alarm_notify_event_t *const ev) {
+    drag_t *const drag = &session->drag;
+    drag_syncer_t *const syncer = &drag->syncer;
+
+    // notifications may still arrive for alarms of earlier drags, or for values requested before the current one
+    if (!drag->active || !syncer->waiting || ev->alarm != syncer->alarm) {
+        return;
+    }
+    const uint64_t counter = ((uint64_t)(uint32_t)ev->counter_value.hi << 32) | ev->counter_value.lo;
+    if (counter < syncer->value) {
+        return;
+    }
+
+    syncer->waiting = 0;
+    evloop_timer_arm(&syncer->timer, 0, 0);
+
+    // the client has redrawn at the last size, so the newest pending size can be sent
+    drag_try_commit(session, drag);
+}
+
+void drag_check_grab(session_t *const session) {
+    xcb_connection_t *const con = session->con;
+    drag_t *const drag = &session->drag;
+
+    xcb_grab_pointer_reply_t *reply = NULL;
+    xcb_generic_error_t *err = NULL;
+
+    if (!drag->active || !drag->grabpending) {
+        return;
+    }
+    if (!xcb_poll_for_reply(con, drag->grabseq, (void **)&reply, &err)) {
+        return;
+    }
+    drag->grabpending = 0;
+
+    if (reply && reply->status == XCB_GRAB_STATUS_SUCCESS) {
+        free(reply);
+        return;
+    }
+
+    LWARN("Failed to grab the pointer (status %u); abandoning drag", (reply) ? reply->status : 0);
+    free(reply);
+    free(err);
+
+    // the press may have frozen the pointer (if it activated a synchronous button grab), so let the client have it after all
+    xcb_allow_events(con, XCB_ALLOW_REPLAY_POINTER, drag->time);
+
+    drag_stop(session);
+}
+
+static void drag_stop(session_t *const session) {
+    xcb_connection_t *const con = session->con;
+    drag_t *const drag = &session->drag;
+
+    if (drag->grabpending) {
+        xcb_discard_reply(con, drag->grabseq);
+        drag->grabpending = 0;
+    }
+
+    syncer_stop(session, &drag->syncer);
+    if (drag->pacer.armed) {
+        evloop_timer_arm(&drag->pacer.timer, 0, 0);
+        drag->pacer.armed = 0;
+    }
+    outline_dealloc(session, &drag->outline);
+
     xcb_ungrab_pointer(con, XCB_CURRENT_TIME);
+    session_defer_flush(session);
 
-    xcb_flush(con);
+    LLOG("%s finished: %u sync requests sent", (drag->side == RESIZE_NONE) ? "Move" : "Resize", drag->syncer.requests);
 
-out:
-    free(qreply);
-    free(greply);
+    drag->active = 0;
+    drag->client = NULL;
+    drag->dirty = 0;
 }
 
-static uint8_t get_resize_side_mask(offset_t ptrpos, offset_t innerpos, extent_t innersize, margin_t framemarg) {
-    const resize_side_t inleft =    RESIZE_LEFT *   (ptrpos.x <= (int32_t)innerpos.x);
-    const resize_side_t inright =   RESIZE_RIGHT *  (ptrpos.x >= (int32_t)(innerpos.x + innersize.width));
-    const resize_side_t intop =     RESIZE_TOP *    (ptrpos.y <= (int32_t)(innerpos.y - (framemarg.top - framemarg.left)));
-    const resize_side_t inbottom =  RESIZE_BOTTOM * (ptrpos.y >= (int32_t)(innerpos.y + innersize.height));
+static drag_outline_t outline_init(session_t *const session) {
+    xcb_connection_t *const con = session->con;
+    xcb_screen_t *const scr = session->scr;
+
+    drag_outline_t outline = {
+        .strips = { XCB_NONE, XCB_NONE, XCB_NONE, XCB_NONE },
+        .mapped = 0
+    };
+
+    if (!session->cfg.drag_n_drop.outline) {
+        return outline;
+    }
+
+    for (uint32_t i = 0; i < 4; i++) {
+        outline.strips[i] = xcb_generate_id(con);
+
+        xcb_create_window(con, XCB_COPY_FROM_PARENT, outline.strips[i], session->root,
+            0, 0, 1, 1,
+            0,
+            XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT,
+            XCB_CW_BACK_PIXEL | XCB_CW_OVERRIDE_REDIRECT,
+            (uint32_t []) { scr->white_pixel, 1 });
+    }
 
-    return inleft | inright | intop | inbottom;
+    return outline;
 }
 
-static void move_and_wait(xcb_connection_t *const con, session_t *const session, client_t *const client, const eventhandler_t handler,
-    offset_t ptrpos, offset_t innerpos)
-{
-    xcb_generic_event_t *ev;
-    xcb_motion_notify_event_t *mnev;
+static void outline_dealloc(session_t *const session, drag_outline_t *const outline) {
+    for (uint32_t i = 0; i < 4; i++) {
+        if (outline->strips[i] != XCB_NONE) {
+            xcb_destroy_window(session->con, outline->strips[i]);
+        }
+        outline->strips[i] = XCB_NONE;
+    }
+    outline->mapped = 0;
+
+    session_defer_flush(session);
+}
 
-    offset_t ptrdelta;
-    offset_t newpos;
+static void outline_show(session_t *const session, drag_outline_t *const outline, const client_t *const client, const rect_t rect) {
+    xcb_connection_t *const con = session->con;
 
-    uint8_t ungrab = 0;
+    const margin_t margin = client->properties.innermargin;
+    const uint32_t t = DRAG_OUTLINE_WIDTH;
+
+    // outline the frame rather than the inner window
+    const int32_t x = rect.offset.x - (int32_t)margin.left,
+                  y = rect.offset.y - (int32_t)margin.top;
+    const uint32_t w = rect.extent.width + margin.left + margin.right,
+                   h = rect.extent.height + margin.top + margin.bottom;
+    const uint32_t inw = (w > 2 * t) ? w - 2 * t : 1;
+
+    // left, right, top, bottom (the top and bottom strips span between the side strips)
+    const uint32_t geom[4][4] = {
+        { x,                    y,                      t,      h },
+        { x + (int32_t)(w - t), y,                      t,      h },
+        { x + (int32_t)t,       y,                      inw,    t },
+        { x + (int32_t)t,       y + (int32_t)(h - t),   inw,    t },
+    };
 
-    do {
-        // wait for next event
-        while (!(ev = xcb_wait_for_event(con))) {
-            xcb_flush(con);
+    for (uint32_t i = 0; i < 4; i++) {
+        // keep the outline above anything mapped during the drag
+        xcb_configure_window(con, outline->strips[i],
+            XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH | XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_STACK_MODE,
+            (uint32_t []) {
+                geom[i][0], geom[i][1], geom[i][2], geom[i][3],
+                XCB_STACK_MODE_ABOVE
+            });
+
+        if (!outline->mapped) {
+            xcb_map_window(con, outline->strips[i]);
         }
+    }
+    outline->mapped = 1;
 
-        // get change in pointer position
-        mnev = (xcb_motion_notify_event_t *)ev;
-        ptrdelta = (offset_t){ mnev->event_x - ptrpos.x, mnev->event_y - ptrpos.y };
-
-        newpos = (offset_t){ innerpos.x + ptrdelta.x, innerpos.y + ptrdelta.y };
-
-        switch (ev->response_type) {
-        case XCB_CONFIGURE_REQUEST:
-        case XCB_MAP_REQUEST:
-            handler(session, ev);
-            // fallthrough
-        case XCB_MOTION_NOTIFY:
-            clientprops_set_pos(con, client, newpos);
-            break;
-        case XCB_KEY_PRESS:
-        case XCB_KEY_RELEASE:
-        case XCB_BUTTON_PRESS:
-        case XCB_BUTTON_RELEASE:
-            ungrab = 1;
-            break;
+    session_defer_flush(session);
+}
+
+static void pacer_start(session_t *const session, drag_pacer_t *const pacer, const client_t *const client) {
+    pacer->interval = 0;
+    pacer->armed = 0;
+
+    if (!session->cfg.drag_n_drop.pace_to_refresh || pacer->timer.fd < 0) {
+        return;
+    }
+
+    // pace to the monitor the client is on
+    const monitor_t *const monitor = monitorset_get(&session->monitorset, client->monitor);
+
+    const uint32_t refresh = (monitor && monitor->refresh) ? monitor->refresh : DRAG_FALLBACK_REFRESH;
+
+    pacer->interval = 1000000000000ULL / refresh;
+}
+
+static uint8_t pacer_try_commit(drag_pacer_t *const pacer) {
+    if (!pacer->interval) {
+        return 1;
+    }
+    if (pacer->armed) {
+        return 0;
+    }
+
+    // one-shot: the timer is only restarted by the next commit, so it doesn't wake us while the pointer is still
+    evloop_timer_arm(&pacer->timer, pacer->interval, 0);
+
+    pacer->armed = 1;
+    return 1;
+}
+
+static void pacer_cb(evloop_source_t *const src, void *const data) {
+    session_t *const session = (session_t *)data;
+    drag_t *const drag = &session->drag;
+
+    // suppress unused parameter
+    (void)src;
+
+    drag->pacer.armed = 0;
+
+    // catch up with any motion that arrived since the last commit
+    if (drag->active) {
+        drag_try_commit(session, drag);
+    }
+}
+
+static void syncer_start(session_t *const session, drag_syncer_t *const syncer, const drag_t *const drag) {
+    xcb_connection_t *const con = session->con;
+    const clientprops_t *const props = &drag->client->properties;
+
+    syncer->alarm = XCB_NONE;
+    syncer->value = 0;
+    syncer->querypending = 0;
+    syncer->waiting = 0;
+    syncer->requests = 0;
+
+    // outline drags don't resize the client until they end
+    if (drag->side == RESIZE_NONE || drag->outline.strips[0] != XCB_NONE || syncer->timer.fd < 0 || !session->syncbase ||
+        !props->sync_request || props->synccounter == XCB_NONE)
+    {
+        return;
+    }
+
+    // requested values must be above the counter's current value; the reply is only collected when the first request is sent
+    syncer->queryseq = xcb_sync_query_counter(con, props->synccounter).sequence;
+    syncer->querypending = 1;
+
+    // the alarm triggers when the counter reaches its value; with a zero delta it is then deactivated until the value is changed by the next request
+    syncer->alarm = xcb_generate_id(con);
+    xcb_sync_create_alarm(con, syncer->alarm,
+        XCB_SYNC_CA_COUNTER | XCB_SYNC_CA_VALUE_TYPE | XCB_SYNC_CA_TEST_TYPE | XCB_SYNC_CA_DELTA | XCB_SYNC_CA_EVENTS,
+        (uint32_t []) {
+            props->synccounter,
+            XCB_SYNC_VALUETYPE_ABSOLUTE,
+            XCB_SYNC_TESTTYPE_POSITIVE_COMPARISON,
+            0, 0,
+            1
+        });
+}
+
+static void syncer_stop(session_t *const session, drag_syncer_t *const syncer) {
+    xcb_connection_t *const con = session->con;
+
+    if (syncer->querypending) {
+        xcb_discard_reply(con, syncer->queryseq);
+        syncer->querypending = 0;
+    }
+    if (syncer->alarm != XCB_NONE) {
+        xcb_sync_destroy_alarm(con, syncer->alarm);
+        session_defer_flush(session);
+    }
+    if (syncer->waiting) {
+        evloop_timer_arm(&syncer->timer, 0, 0);
+    }
+
+    syncer->alarm = XCB_NONE;
+    syncer->waiting = 0;
+}
+
+static void syncer_request(session_t *const session, client_t *const client, drag_syncer_t *const syncer, const xcb_timestamp_t time) {
+    xcb_connection_t *const con = session->con;
+    const xcb_window_t inner = client->inner;
+
+    // by the first request, the counter query has usually been answered already
+    if (syncer->querypending) {
+        syncer->querypending = 0;
+
+        xcb_sync_query_counter_reply_t *const reply = xcb_sync_query_counter_reply(con, (xcb_sync_query_counter_cookie_t){ syncer->queryseq }, NULL);
+        if (!reply) {
+            LWARN("Failed to query sync counter of client 0x%08x; resizes will not be synchronised", inner);
+            syncer_stop(session, syncer);
+            return;
         }
+        syncer->value = ((uint64_t)(uint32_t)reply->counter_value.hi << 32) | reply->counter_value.lo;
+        free(reply);
+    }
+
+    const uint64_t value = ++syncer->value;
+
+    xcb_client_message_event_t ev;
+    memset(&ev, 0, sizeof(xcb_client_message_event_t));
 
-        free(ev);
-    } while (!ungrab);
+    ev.response_type = XCB_CLIENT_MESSAGE;
+    ev.format = 32;
+    ev.window = inner;
+    ev.type = ATOMS_WM_PROTOCOLS;
+    ev.data.data32[0] = ATOMS__NET_WM_SYNC_REQUEST;
+    ev.data.data32[1] = time;
+    ev.data.data32[2] = (uint32_t)value;
+    ev.data.data32[3] = (uint32_t)(value >> 32);
+
+    xcb_send_event(con, 0, inner, XCB_EVENT_MASK_NO_EVENT, (const char *)&ev);
+
+    xcb_sync_change_alarm(con, syncer->alarm, XCB_SYNC_CA_VALUE, (uint32_t []) { (uint32_t)(value >> 32), (uint32_t)value });
+
+    syncer->waiting = 1;
+    syncer->requests++;
+    evloop_timer_arm(&syncer->timer, DRAG_SYNC_TIMEOUT_NS, 0);
 }
 
-static void resize_and_wait(xcb_connection_t *const con, session_t *const session, client_t *const client, const eventhandler_t handler,
-    offset_t ptrpos, offset_t innerpos, extent_t innersize, uint8_t side)
-{
-    xcb_generic_event_t *ev;
-    xcb_motion_notify_event_t *mnev;
+static void syncer_cb(evloop_source_t *const src, void *const data) {
+    session_t *const session = (session_t *)data;
+    drag_t *const drag = &session->drag;
 
-    extent_t updsize;
-    offset_t updpos;
-    offset_t ptrdelta;
+    // suppress unused parameter
+    (void)src;
 
-    uint8_t ungrab = 0;
+    if (!drag->active || !drag->syncer.waiting) {
+        return;
+    }
 
-    const offset_t inc = client->properties.sizeinc;
-    const extent_t minsize = client->properties.minsize,
-                   maxsize = client->properties.maxsize;
+    LWARN("Client 0x%08x didn't answer sync request within %llu ms; no longer synchronising the resize", drag->client->inner,
+        (unsigned long long)(DRAG_SYNC_TIMEOUT_NS / 1000000));
+    syncer_stop(session, &drag->syncer);
 
-    // When resizing from top or left, the window is moved to counter it. Here we calculate the minimum of this movement.
-    // We do this by getting the maximum change in position (window size minus the minimum inner-window size) and adding it to the initial position.
-    // We will clamp to this maximum position for when the window's minimum size is reached (from top or left edges).
-    const offset_t maxpos = {
-        .x = innerpos.x + (innersize.width - minsize.width),
-        .y = innerpos.y + (innersize.height - minsize.height)
-    };
-    const offset_t minpos = {
-        .x = innerpos.x + (innersize.width - maxsize.width),
-        .y = innerpos.y + (innersize.height - maxsize.height)
+    drag_try_commit(session, drag);
+}
+
+static void drag_try_commit(session_t *const session, drag_t *const drag) {
+    drag_syncer_t *const syncer = &drag->syncer;
+
+    // while the client is still redrawing, only the newest size is kept (in the drag's pointer position) until it is done
+    if (!drag->dirty || syncer->waiting || !pacer_try_commit(&drag->pacer)) {
+        return;
+    }
+
+    drag_commit_synced(session, drag);
+}
+
+static void drag_commit_synced(session_t *const session, drag_t *const drag) {
+    drag_syncer_t *const syncer = &drag->syncer;
+
+    if (syncer->alarm == XCB_NONE) {
+        drag_commit(session, drag);
+        return;
+    }
+
+    // only resizes that actually change the client's size make it redraw, so a sync request is only sent for those
+    // (the size is constrained as it would be when committed, e.g. to size limits and increments)
+    const extent_t size = drag->client->properties.rect.extent;
+    const extent_t newsize = clientprops_constrain(session, drag->client, (rect_t){ resize_target(session, drag), drag->start.offset }).extent;
+
+    if (newsize.width != size.width || newsize.height != size.height) {
+        syncer_request(session, drag->client, syncer, drag->time);
+        session_defer_flush(session);
+    }
+
+    drag_commit(session, drag);
+}
+
+static void drag_commit(session_t *const session, drag_t *const drag) {
+    if (drag->outline.strips[0] != XCB_NONE) {
+        drag->target = outline_target(session, drag);
+        outline_show(session, &drag->outline, drag->client, drag->target);
+    } else if (drag->side == RESIZE_NONE) {
+        move_commit(session, drag);
+    } else {
+        resize_commit(session, drag);
+    }
+
+    drag->dirty = 0;
+}
+
+static offset_t snap_offset(session_t *const session, const drag_t *const drag, const int32_t x0, const int32_t x1, const int32_t y0, const int32_t y1,
+    const uint8_t sides)
+{
+    const uint32_t threshold = session->cfg.drag_n_drop.snap_threshold;
+    if (!threshold) {
+        return (offset_t){ 0, 0 };
+    }
+
+    const struct {
+        resize_side_t side;
+        spatialaxis_t axis;
+        int32_t pos;
+        int32_t start, end;
+    } edges[] = {
+        { RESIZE_LEFT,   SPATIAL_AXIS_VERTICAL,   x0, y0, y1 },
+        { RESIZE_RIGHT,  SPATIAL_AXIS_VERTICAL,   x1, y0, y1 },
+        { RESIZE_TOP,    SPATIAL_AXIS_HORIZONTAL, y0, x0, x1 },
+        { RESIZE_BOTTOM, SPATIAL_AXIS_HORIZONTAL, y1, x0, x1 },
     };
 
-    do {
-        // wait for next event
-        while (!(ev = xcb_wait_for_event(con))) {
-            xcb_flush(con);
+    // on each axis, the frame snaps by whichever of its edges is nearest to another edge
+    uint32_t best[2] = { UINT32_MAX, UINT32_MAX };
+    int32_t delta[2] = { 0, 0 };
+
+    for (uint32_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        const spatialaxis_t axis = edges[i].axis;
+        spatialedge_t edge;
+
+        if (!(sides & edges[i].side)) {
+            continue;
         }
 
-        // get change in pointer position (and round it to size increments)
-        mnev = (xcb_motion_notify_event_t*) ev;
-        ptrdelta = (offset_t){ mnev->event_x - ptrpos.x, mnev->event_y - ptrpos.y };
-        if (inc.x)
-            ptrdelta.x = rndto(ptrdelta.x, inc.x);
-        if (inc.y)
-            ptrdelta.y = rndto(ptrdelta.y, inc.y);
-
-        updsize = innersize;
-        updpos = innerpos;
-
-        uint8_t move = 0; //bit-field -- 01: move right; 10: move down.
-
-        switch (ev->response_type) {
-        case XCB_CONFIGURE_REQUEST:
-        case XCB_MAP_REQUEST:
-            handler(session, ev);
-        case XCB_MOTION_NOTIFY:
-            if (side & RESIZE_LEFT) {
-                updsize.width -= ptrdelta.x;
-                updpos.x += ptrdelta.x;
-                move |= 0x1;
-            }
-            if (side & RESIZE_RIGHT) {
-                updsize.width += ptrdelta.x;
-            }
-            if (side & RESIZE_TOP) {
-                updsize.height -= ptrdelta.y;
-                updpos.y += ptrdelta.y;
-                move |= 0x2;
-            }
-            if (side & RESIZE_BOTTOM) {
-                updsize.height += ptrdelta.y;
-            }
-
-            // dimc is a bit mask indicating if the width and height of the client has changed respectively.
-            const uint8_t dimc = clientprops_set_size(con, client, updsize);
-
-            if (!move) {
-                break;
-            }
-
-            // move the window (clamped to maxpos and minpos)
-            if ((move & 0x1) != 0 && (dimc & 0x1) == 0) {
-                if (dimc & 0x4)
-                    updpos.x = minpos.x;
-                else
-                    updpos.x = maxpos.x;
-            }
-            if ((move & 0x2) != 0 && (dimc & 0x2) == 0) {
-                if (dimc & 0x8)
-                    updpos.y = minpos.y;
-                else
-                    updpos.y = maxpos.y;
-            }
-            clientprops_set_pos(con, client, updpos);
-            break;
-        case XCB_KEY_PRESS:
-        case XCB_KEY_RELEASE:
-        case XCB_BUTTON_PRESS:
-        case XCB_BUTTON_RELEASE:
-            ungrab = 1;
-            break;
+        if (spatial_nearest_line(&session->spatial, axis, edges[i].pos, edges[i].start, edges[i].end, threshold,
+                SPATIAL_KIND_CLIENT | SPATIAL_KIND_MONITOR, drag->client, &edge) && edge.dist < best[axis]) {
+            best[axis] = edge.dist;
+            delta[axis] = edge.pos - edges[i].pos;
         }
+    }
 
-        free(ev);
-    } while (!ungrab);
+    return (offset_t){ delta[SPATIAL_AXIS_VERTICAL], delta[SPATIAL_AXIS_HORIZONTAL] };
+}
+
+static offset_t move_target(session_t *const session, const drag_t *const drag) {
+    const margin_t margin = drag->client->properties.innermargin;
+    const rect_t start = drag->start;
+
+    // get change in pointer position
+    const offset_t ptrdelta = { drag->ptr.x - drag->ptrstart.x, drag->ptr.y - drag->ptrstart.y };
+
+    const offset_t innerpos = { start.offset.x + ptrdelta.x, start.offset.y + ptrdelta.y };
+
+    // snap the frame as a whole
+    const int32_t x0 = innerpos.x - (int32_t)margin.left, x1 = innerpos.x + (int32_t)(start.extent.width + margin.right),
+                  y0 = innerpos.y - (int32_t)margin.top,  y1 = innerpos.y + (int32_t)(start.extent.height + margin.bottom);
+    const offset_t snap = snap_offset(session, drag, x0, x1, y0, y1, RESIZE_LEFT | RESIZE_RIGHT | RESIZE_TOP | RESIZE_BOTTOM);
+
+    return (offset_t){ innerpos.x + snap.x, innerpos.y + snap.y };
+}
+
+static extent_t resize_target(session_t *const session, const drag_t *const drag) {
+    const uint8_t side = drag->side;
+    const offset_t inc = drag->client->properties.sizeinc;
+    const margin_t margin = drag->client->properties.innermargin;
+    const rect_t start = drag->start;
+
+    // get change in pointer position
+    offset_t ptrdelta = { drag->ptr.x - drag->ptrstart.x, drag->ptr.y - drag->ptrstart.y };
+
+    // snap the frame edges being dragged (the pointer delta applies to each of them alike)
+    const int32_t x0 = start.offset.x - (int32_t)margin.left + ((side & RESIZE_LEFT) ? ptrdelta.x : 0),
+                  x1 = start.offset.x + (int32_t)(start.extent.width + margin.right) + ((side & RESIZE_RIGHT) ? ptrdelta.x : 0),
+                  y0 = start.offset.y - (int32_t)margin.top + ((side & RESIZE_TOP) ? ptrdelta.y : 0),
+                  y1 = start.offset.y + (int32_t)(start.extent.height + margin.bottom) + ((side & RESIZE_BOTTOM) ? ptrdelta.y : 0);
+    const offset_t snap = snap_offset(session, drag, x0, x1, y0, y1, side);
+    ptrdelta.x += snap.x;
+    ptrdelta.y += snap.y;
+
+    // round to size increments (which take precedence over snapping)
+    if (inc.x)
+        ptrdelta.x = rndto(ptrdelta.x, inc.x);
+    if (inc.y)
+        ptrdelta.y = rndto(ptrdelta.y, inc.y);
+
+    extent_t updsize = start.extent;
+
+    if (side & RESIZE_LEFT) {
+        updsize.width -= ptrdelta.x;
+    }
+    if (side & RESIZE_RIGHT) {
+        updsize.width += ptrdelta.x;
+    }
+    if (side & RESIZE_TOP) {
+        updsize.height -= ptrdelta.y;
+    }
+    if (side & RESIZE_BOTTOM) {
+        updsize.height += ptrdelta.y;
+    }
+
+    return updsize;
+}
+
+static offset_t resize_anchor(const drag_t *const drag, const extent_t size) {
+    const rect_t start = drag->start;
+
+    offset_t pos = start.offset;
+
+    // when resizing from the left or top, the client is moved to keep its right or bottom edge in place (this also holds once the size is clamped)
+    if (drag->side & RESIZE_LEFT) {
+        pos.x += (int32_t)start.extent.width - (int32_t)size.width;
+    }
+    if (drag->side & RESIZE_TOP) {
+        pos.y += (int32_t)start.extent.height - (int32_t)size.height;
+    }
+
+    return pos;
+}
+
+static rect_t outline_target(session_t *const session, const drag_t *const drag) {
+    const client_t *const client = drag->client;
+
+    if (drag->side == RESIZE_NONE) {
+        return clientprops_constrain(session, client, (rect_t){ drag->start.extent, move_target(session, drag) });
+    }
+
+    // the position depends on the size the client is clamped to
+    const extent_t size = clientprops_constrain(session, client, (rect_t){ resize_target(session, drag), drag->start.offset }).extent;
+
+    return clientprops_constrain(session, client, (rect_t){ size, resize_anchor(drag, size) });
+}
+
+static void move_commit(session_t *const session, const drag_t *const drag) {
+    clientprops_set_pos(session, drag->client, move_target(session, drag));
+}
+
+static void resize_commit(session_t *const session, const drag_t *const drag) {
+    client_t *const client = drag->client;
+
+    clientprops_set_size(session, client, resize_target(session, drag));
+
+    if (drag->side & (RESIZE_LEFT | RESIZE_TOP)) {
+        clientprops_set_pos(session, client, resize_anchor(drag, client->properties.rect.extent));
+    }
 }
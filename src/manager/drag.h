@@ -12,23 +12,168 @@
     extern "C" {
 #endif
 
-#include "manager/events.h"
+#include "data/rect.h"
+#include "manager/client/clientset.h"
+#include "manager/evloop.h"
 
 #include <xcb/xcb.h>
+#include <xcb/sync.h>
 
 typedef struct session_t session_t;
 typedef struct client_t client_t;
 
 /**
- * Initiate and handle client click-and-drag functionality. This function does not return until the button is released and the window ungrabbed.
- * Depending on the pointer's starting position relative to the client's frame, this function will determine whether to move or resize the window.
+ * Outline of a client's frame, drawn with four thin override-redirect windows so that nothing needs to be drawn onto (or repainted under) them.
+ */
+typedef struct drag_outline_t {
+    /** Left, right, top and bottom strips, or XCB_NONE if the drag isn't drawn as an outline */
+    xcb_window_t strips[4];
+    /** 1 once the strips have been mapped */
+    uint8_t mapped;
+} drag_outline_t;
+
+/**
+ * Limits the rate of geometry commits during a drag to the refresh rate of the dragged client's monitor.
+ */
+typedef struct drag_pacer_t {
+    /** Pacing timer (fd is -1 if it couldn't be created, in which case drags are never paced) */
+    evloop_source_t timer;
+    /** Minimum interval between commits in nanoseconds, or 0 if the current drag isn't paced */
+    uint64_t interval;
+    /** 1 while the timer is running, i.e. while less than one interval has passed since the last commit */
+    uint8_t armed;
+} drag_pacer_t;
+
+/**
+ * Synchronises resizes with a client supporting _NET_WM_SYNC_REQUEST: each resize is preceded by a sync request, and the next one is held back until
+ * the client has set its counter to the requested value (i.e. it has redrawn at the new size). Only the newest size is kept in the meantime.
+ */
+typedef struct drag_syncer_t {
+    /** Timer giving up on an unanswered sync request (fd is -1 if it couldn't be created, in which case resizes are never synchronised) */
+    evloop_source_t timer;
+    /** Alarm triggered once the client's counter reaches `value`, or XCB_NONE if the current drag isn't synchronised */
+    xcb_sync_alarm_t alarm;
+    /** Counter value of the most recent sync request */
+    uint64_t value;
+    /** Sequence number of the counter query sent at the start of the drag, if its reply hasn't been collected yet */
+    uint32_t queryseq;
+    /** 1 while the reply to the counter query is outstanding */
+    uint8_t querypending;
+    /** 1 while a sync request is outstanding */
+    uint8_t waiting;
+    /** Amount of sync requests sent during the current drag */
+    uint32_t requests;
+} drag_syncer_t;
+
+/**
+ * State of client dragging (moving or resizing). A drag is started by a button press and then advanced by the session's event dispatcher, so every
+ * other event keeps being handled as usual while it is in progress.
+ */
+typedef struct drag_t {
+    /** 1 while a drag is in progress */
+    uint8_t active;
+
+    /** The client being dragged */
+    client_t *client;
+    /** Sides of the client being resized, or 0 if it is being moved */
+    uint8_t side;
+
+    /** Pointer position at the start of the drag */
+    offset_t ptrstart;
+    /** Inner window geometry at the start of the drag */
+    rect_t start;
+    /** Most recent pointer position */
+    offset_t ptr;
+    /** Timestamp of the most recent pointer event */
+    xcb_timestamp_t time;
+
+    /** Sequence number of the pointer grab request, if its reply hasn't been checked yet */
+    uint32_t grabseq;
+    /** 1 while the reply to the pointer grab request is outstanding */
+    uint8_t grabpending;
+
+    /** Outline drawn instead of moving or resizing the client, if enabled in the session config */
+    drag_outline_t outline;
+    /** (Constrained) inner geometry shown by the outline, to be applied once the drag ends */
+    rect_t target;
+
+    /** 1 if the pointer has moved since client geometry was last committed */
+    uint8_t dirty;
+
+    /** Commit rate limiter */
+    drag_pacer_t pacer;
+    /** _NET_WM_SYNC_REQUEST state */
+    drag_syncer_t syncer;
+} drag_t;
+
+/**
+ * Initialise the session's (inactive) drag state, creating its timers on the session's event loop. Returns 0 if a timer couldn't be created; dragging
+ * still works in this case, but without pacing or resize synchronisation.
+ */
+uint8_t drag_init(
+    session_t *const session
+);
+
+/**
+ * Free resources held by the session's drag state, ending any drag in progress first.
+ */
+void drag_dealloc(
+    session_t *const session
+);
+
+/**
+ * Start dragging `client` from button press `ev` on its window with role `role`. The client is resized if the press was on one of its frame's resize
+ * grips, and moved otherwise. The pointer is grabbed without waiting for the reply, so this makes no round trips to the X server.
+ *
+ * If `pace_to_refresh` is enabled in the session config, pointer motion is still tracked continuously but client geometry is committed at most once
+ * per refresh interval of the monitor the client is on.
  *
- * While this function is running, any other events in the manager will be handled by the specified event handler.
+ * If `outline` is enabled in the session config, only an outline of the client's new geometry is drawn during the drag; the client itself is moved
+ * or resized once, when the drag ends.
  */
-void drag_start_and_wait(
+void drag_start(
     session_t *const session,
     client_t *const client,
-    const eventhandler_t handler
+    const clientrole_t role,
+    const xcb_button_press_event_t *const ev
+);
+
+/**
+ * End the drag in progress (if any), applying any geometry held back by pacing, syncing or outlining, and ungrab the pointer.
+ */
+void drag_end(
+    session_t *const session
+);
+
+/**
+ * Abandon the drag in progress if it is of `client`, e.g. as the client is being unmanaged. No geometry is applied to the client.
+ */
+void drag_forget_client(
+    session_t *const session,
+    const client_t *const client
+);
+
+/**
+ * Handle pointer motion during a drag.
+ */
+void drag_handle_motion(
+    session_t *const session,
+    const xcb_motion_notify_event_t *const ev
+);
+
+/**
+ * Handle an XSync AlarmNotify event, which may answer a sync request sent during a resize.
+ */
+void drag_handle_alarm(
+    session_t *const session,
+    const xcb_sync_alarm_notify_event_t *const ev
+);
+
+/**
+ * Check whether the pointer grab of the drag in progress succeeded, if its reply has arrived. The drag is abandoned if the grab failed.
+ */
+void drag_check_grab(
+    session_t *const session
 );
 
 #ifdef __cplusplus
@@ -0,0 +1,125 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#include "errtable.h"
+
+#include "util/logging.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Returns 1 if sequence number `a` comes before `b`, accounting for wrap-around.
+ */
+static uint8_t seq_before(
+    const uint32_t a,
+    const uint32_t b
+);
+
+/**
+ * Double the capacity of `table`, unwrapping its ring into the new space. Returns 0 if there is an error.
+ */
+static uint8_t grow(
+    errtable_t *const table
+);
+
+errtable_t errtable_init(void) {
+    errtable_t table;
+
+    table.entries = malloc(sizeof(errtable_entry_t) * ERRTABLE_INIT_CAP);
+    if (!table.entries) {
+        LFATAL("malloc() fault");
+        KILL();
+    }
+    table.head = 0;
+    table.len = 0;
+    table.cap = ERRTABLE_INIT_CAP;
+
+    return table;
+}
+
+void errtable_dealloc(errtable_t *const table) {
+    free(table->entries);
+
+    memset(table, 0, sizeof(errtable_t));
+}
+
+void errtable_track(errtable_t *const table, const xcb_void_cookie_t cookie, const xcb_window_t client, const char *const op,
+    const errtable_handler_t handler)
+{
+    if (table->len == table->cap && !grow(table)) {
+        // out of memory; forget about the oldest request rather than lose track of new ones
+        LWARN("Error table full, no longer tracking request %u (%s)", table->entries[table->head].sequence, table->entries[table->head].op);
+
+        table->head = (table->head + 1) & (table->cap - 1);
+        table->len--;
+    }
+
+    table->entries[(table->head + table->len) & (table->cap - 1)] = (errtable_entry_t){
+        .sequence = cookie.sequence,
+        .client = client,
+        .op = op,
+        .handler = handler
+    };
+    table->len++;
+}
+
+void errtable_retire(errtable_t *const table, const uint32_t sequence) {
+    while (table->len && seq_before(table->entries[table->head].sequence, sequence)) {
+        table->head = (table->head + 1) & (table->cap - 1);
+        table->len--;
+    }
+}
+
+uint8_t errtable_take(errtable_t *const table, const uint32_t sequence, errtable_entry_t *const entry) {
+    // entries are ordered by sequence, and older ones are retired before this is called, so the match (if any) is normally at the head
+    for (uint32_t i = 0; i < table->len; i++) {
+        errtable_entry_t *const e = &table->entries[(table->head + i) & (table->cap - 1)];
+
+        if (e->sequence == sequence) {
+            *entry = *e;
+
+            // mark as retired; it is removed once it reaches the head of the ring
+            e->op = NULL;
+            e->handler = NULL;
+            e->client = XCB_NONE;
+            if (i == 0) {
+                table->head = (table->head + 1) & (table->cap - 1);
+                table->len--;
+            }
+
+            return entry->op != NULL;
+        }
+        if (seq_before(sequence, e->sequence)) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static uint8_t seq_before(const uint32_t a, const uint32_t b) {
+    return (int32_t)(a - b) < 0;
+}
+
+static uint8_t grow(errtable_t *const table) {
+    const uint32_t cap = table->cap << 1;
+
+    errtable_entry_t *const entries = realloc(table->entries, sizeof(errtable_entry_t) * cap);
+    if (!entries) {
+        LERR("realloc() fault when growing error table");
+        return 0;
+    }
+
+    // the table is full, so the ring wraps around at the old capacity: move the wrapped part (before `head`) to just after the old end
+    memcpy(&entries[table->cap], entries, sizeof(errtable_entry_t) * table->head);
+
+    table->entries = entries;
+    table->cap = cap;
+
+    return 1;
+}
@@ -0,0 +1,107 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#pragma once
+#ifndef __awm__errtable_h
+#define __awm__errtable_h
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <xcb/xcb.h>
+
+/**
+ * Amount of requests that can initially be tracked at once; the table doubles in size whenever it fills up. Must be a power of two.
+ */
+#define ERRTABLE_INIT_CAP 1024
+
+typedef struct session_t session_t;
+typedef struct errtable_entry_t errtable_entry_t;
+
+/**
+ * Pointer to a function called when a tracked request fails. The error has already been logged when this is called.
+ */
+typedef void (*errtable_handler_t)(session_t *const, const errtable_entry_t *const, xcb_generic_error_t *const);
+
+/**
+ * Context of an unchecked request whose errors are tracked.
+ */
+typedef struct errtable_entry_t {
+    /** Full sequence number of the request */
+    uint32_t sequence;
+    /** Inner window of the client that the request was made for, or XCB_NONE */
+    xcb_window_t client;
+    /** Description of the operation, used when logging errors (e.g. "reparenting inner under frame") */
+    const char *op;
+    /** Function to call if the request fails, or NULL to only log the error */
+    errtable_handler_t handler;
+} errtable_entry_t;
+
+/**
+ * A table attributing X errors to the requests that caused them, keyed by request sequence number.
+ *
+ * Requests are tracked in the order they are sent, so the table is kept as a ring ordered by sequence. Errors for unchecked requests arrive through
+ * the event queue; once an event or error with a later sequence number arrives, earlier requests are known to have completed and are retired.
+ * As no requests are retired while none are read (e.g. while existing windows are adopted under a server grab), the ring grows rather than
+ * forgetting requests that may still fail.
+ */
+typedef struct errtable_t {
+    /** Ring of tracked requests */
+    errtable_entry_t *entries;
+    /** Index of the oldest tracked request in `entries` */
+    uint32_t head;
+    /** Amount of tracked requests */
+    uint32_t len;
+    /** Capacity of `entries` (a power of two) */
+    uint32_t cap;
+} errtable_t;
+
+/**
+ * Reserve memory for and initialise an error table.
+ */
+errtable_t errtable_init(void);
+
+/**
+ * Free memory allocated for the given error table.
+ */
+void errtable_dealloc(
+    errtable_t *const table
+);
+
+/**
+ * Track errors from the (unchecked) request with the given cookie. `op` must be a static string.
+ */
+void errtable_track(
+    errtable_t *const table,
+    const xcb_void_cookie_t cookie,
+    const xcb_window_t client,
+    const char *const op,
+    const errtable_handler_t handler
+);
+
+/**
+ * Retire all tracked requests that were sent before `sequence` (i.e. that have been processed without error by the time an event with that sequence
+ * number is recieved).
+ */
+void errtable_retire(
+    errtable_t *const table,
+    const uint32_t sequence
+);
+
+/**
+ * Find the tracked request with sequence number `sequence`, copy it into `entry`, and stop tracking it. Returns 0 if it is not tracked.
+ */
+uint8_t errtable_take(
+    errtable_t *const table,
+    const uint32_t sequence,
+    errtable_entry_t *const entry
+);
+
+#ifdef __cplusplus
+    }
+#endif
+#endif
@@ -0,0 +1,129 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#include "evbatch.h"
+
+#include <stdlib.h>
+
+/**
+ * Get the window that the given event concerns, or XCB_NONE if unknown (in which case the event is treated as concerning every window).
+ */
+static xcb_window_t event_window(
+    const xcb_generic_event_t *const ev
+);
+
+/**
+ * Merge ConfigureRequest `src` into the earlier ConfigureRequest `dst` on the same window. Values set in `src` override those in `dst`.
+ */
+static void merge_configure_request(
+    xcb_configure_request_event_t *const dst,
+    const xcb_configure_request_event_t *const src
+);
+
+uint8_t evbatch_push(evbatch_t *const batch, xcb_generic_event_t *const ev) {
+    const uint8_t t = ev->response_type & ~0x80;
+    const xcb_window_t win = event_window(ev);
+
+    // only these event types are safe to coalesce: their handlers act on the latest state (geometry, property value or pointer position) alone
+    if (win != XCB_NONE && (t == XCB_CONFIGURE_REQUEST || t == XCB_PROPERTY_NOTIFY || t == XCB_MOTION_NOTIFY)) {
+        // look back for an earlier event to merge into; stop at anything else concerning the same window so per-window ordering is kept
+        for (uint32_t i = batch->len; i-- > 0;) {
+            xcb_generic_event_t *const prev = batch->evs[i];
+            const xcb_window_t prevwin = event_window(prev);
+
+            if (prevwin != XCB_NONE && prevwin != win) {
+                continue;
+            }
+            if ((prev->response_type & ~0x80) != t || prevwin == XCB_NONE) {
+                break;
+            }
+
+            if (t == XCB_CONFIGURE_REQUEST) {
+                merge_configure_request((xcb_configure_request_event_t *)prev, (xcb_configure_request_event_t *)ev);
+                free(ev);
+                return 1;
+            }
+
+            // MotionNotify: only the newest pointer position matters
+            // PropertyNotify: the handler re-reads the property, so only the newest notification for each atom matters
+            if (t == XCB_MOTION_NOTIFY || ((xcb_property_notify_event_t *)prev)->atom == ((xcb_property_notify_event_t *)ev)->atom) {
+                batch->evs[i] = ev;
+                free(prev);
+                return 1;
+            }
+        }
+    }
+
+    batch->evs[batch->len++] = ev;
+    return 0;
+}
+
+uint8_t evbatch_full(const evbatch_t *const batch) {
+    return batch->len >= EVBATCH_MAX;
+}
+
+static xcb_window_t event_window(const xcb_generic_event_t *const ev) {
+    switch (ev->response_type & ~0x80) {
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+        case XCB_MOTION_NOTIFY:
+            return ((const xcb_button_press_event_t *)ev)->event;
+        case XCB_ENTER_NOTIFY:
+        case XCB_LEAVE_NOTIFY:
+            return ((const xcb_enter_notify_event_t *)ev)->event;
+        case XCB_FOCUS_IN:
+        case XCB_FOCUS_OUT:
+            return ((const xcb_focus_in_event_t *)ev)->event;
+        case XCB_EXPOSE:
+            return ((const xcb_expose_event_t *)ev)->window;
+        case XCB_CREATE_NOTIFY:
+            return ((const xcb_create_notify_event_t *)ev)->window;
+        case XCB_DESTROY_NOTIFY:
+            return ((const xcb_destroy_notify_event_t *)ev)->window;
+        case XCB_UNMAP_NOTIFY:
+            return ((const xcb_unmap_notify_event_t *)ev)->window;
+        case XCB_MAP_NOTIFY:
+            return ((const xcb_map_notify_event_t *)ev)->window;
+        case XCB_MAP_REQUEST:
+            return ((const xcb_map_request_event_t *)ev)->window;
+        case XCB_REPARENT_NOTIFY:
+            return ((const xcb_reparent_notify_event_t *)ev)->window;
+        case XCB_CONFIGURE_NOTIFY:
+            return ((const xcb_configure_notify_event_t *)ev)->window;
+        case XCB_CONFIGURE_REQUEST:
+            return ((const xcb_configure_request_event_t *)ev)->window;
+        case XCB_PROPERTY_NOTIFY:
+            return ((const xcb_property_notify_event_t *)ev)->window;
+        case XCB_CLIENT_MESSAGE:
+            return ((const xcb_client_message_event_t *)ev)->window;
+        default:
+            return XCB_NONE;
+    }
+}
+
+static void merge_configure_request(xcb_configure_request_event_t *const dst, const xcb_configure_request_event_t *const src) {
+    const uint16_t mask = src->value_mask;
+
+#   define MERGE_MASK_MEMBER(m, e)  \
+    {                               \
+        if (mask & m) {             \
+            dst->e = src->e;        \
+        }                           \
+    }
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_X, x);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_Y, y);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_WIDTH, width);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_HEIGHT, height);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_BORDER_WIDTH, border_width);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_SIBLING, sibling);
+    MERGE_MASK_MEMBER(XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
+#   undef MERGE_MASK_MEMBER
+
+    dst->value_mask |= mask;
+}
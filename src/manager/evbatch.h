@@ -0,0 +1,55 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#pragma once
+#ifndef __awm__evbatch_h
+#define __awm__evbatch_h
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <xcb/xcb.h>
+
+/**
+ * Maximum amount of events held in one batch before it must be dispatched.
+ */
+#define EVBATCH_MAX 256
+
+/**
+ * A batch of events drained from the X event queue, to be dispatched in order.
+ */
+typedef struct evbatch_t {
+    /** Events in the batch, in the order they were recieved. */
+    xcb_generic_event_t *evs[EVBATCH_MAX];
+    /** Amount of events in the batch. */
+    uint32_t len;
+} evbatch_t;
+
+/**
+ * Add `ev` to the end of `batch`.
+ *
+ * If `ev` supersedes an earlier event in the batch (same window, type and, for PropertyNotify, atom) with no other event concerning that window in
+ * between, then the two are merged into the earlier slot and 1 is returned; the superseded event will have been freed in this case. Otherwise 0 is
+ * returned. Pointer motion is merged like this too, so a drag only sees the newest pointer position of each batch.
+ * The batch must not be full (see `evbatch_full()`).
+ */
+uint8_t evbatch_push(
+    evbatch_t *const batch,
+    xcb_generic_event_t *const ev
+);
+
+/**
+ * Returns 1 if no more events can be pushed to `batch`.
+ */
+uint8_t evbatch_full(
+    const evbatch_t *const batch
+);
+
+#ifdef __cplusplus
+    }
+#endif
+#endif
@@ -16,6 +16,23 @@
 
 #include <xcb/xcb_icccm.h>
 
+/**
+ * Record the server timestamp of event `ev` of type `t` as the session's latest known time, if the event carries one.
+ */
+static void record_time(
+    session_t *const session,
+    const xcb_generic_event_t *const ev,
+    const uint8_t t
+);
+
+/**
+ * Handle an X error (response type 0) recieved in the event queue, i.e. from an unchecked request.
+ */
+static void handle_error(
+    session_t *const session,
+    xcb_generic_error_t *const err
+);
+
 /**
  * Handle an event of type XCB_BUTTON_PRESS.
  */
@@ -24,6 +41,22 @@ static void handle_button_press(
     xcb_button_press_event_t *const ev
 );
 
+/**
+ * Handle an event of type XCB_BUTTON_RELEASE.
+ */
+static void handle_button_release(
+    session_t *const session,
+    xcb_button_release_event_t *const ev
+);
+
+/**
+ * Handle an event of type XCB_MOTION_NOTIFY.
+ */
+static void handle_motion_notify(
+    session_t *const session,
+    xcb_motion_notify_event_t *const ev
+);
+
 /**
  * Handle an event of type XCB_UNMAP_NOTIFY.
  */
@@ -48,6 +81,30 @@ static void handle_configure_request(
     xcb_configure_request_event_t *const ev
 );
 
+/**
+ * Handle an event of type XCB_FOCUS_IN.
+ */
+static void handle_focus_in(
+    session_t *const session,
+    xcb_focus_in_event_t *const ev
+);
+
+/**
+ * Handle an event of type XCB_FOCUS_OUT.
+ */
+static void handle_focus_out(
+    session_t *const session,
+    xcb_focus_out_event_t *const ev
+);
+
+/**
+ * Returns 1 if the given focus event reflects a real change of focus between top-level windows (i.e. not caused by a grab or a change within
+ * the window's own hierarchy).
+ */
+static uint8_t focus_event_is_real(
+    const xcb_focus_in_event_t *const ev
+);
+
 /**
  * Handle an event of type XCB_PROPERTY_NOTIFY.
  */
@@ -56,17 +113,23 @@ static void handle_property_notify(
     xcb_property_notify_event_t *const ev
 );
 /** Respond to _NET_WM_NAME */
-static void propertynotify_net_name(xcb_connection_t *const con, client_t *client, xcb_get_property_reply_t *prop);
+static void propertynotify_net_name(session_t *const session, client_t *client, xcb_get_property_reply_t *prop);
 /** Respond to WM_NAME */
-static void propertynotify_name(xcb_connection_t *const con, client_t *client, xcb_get_property_reply_t *prop);
+static void propertynotify_name(session_t *const session, client_t *client, xcb_get_property_reply_t *prop);
 /** Respond to WM_NORMAL_HINTS */
-static void propertynotify_normal_hints(xcb_connection_t *const con, client_t *client, xcb_get_property_reply_t *prop);
+static void propertynotify_normal_hints(session_t *const session, client_t *client, xcb_get_property_reply_t *prop);
+/** Respond to WM_HINTS */
+static void propertynotify_hints(session_t *const session, client_t *client, xcb_get_property_reply_t *prop);
+/** Respond to WM_PROTOCOLS */
+static void propertynotify_protocols(session_t *const session, client_t *client, xcb_get_property_reply_t *prop);
+/** Respond to _NET_WM_SYNC_REQUEST_COUNTER */
+static void propertynotify_sync_counter(session_t *const session, client_t *client, xcb_get_property_reply_t *prop);
 
 /**
  * Definition for a function to handle a notification on a particular window property.
  * (in the form of the static handler functions defined above)
  */
-typedef void (*propertynotify_handler_func_t)(xcb_connection_t *const, client_t *, xcb_get_property_reply_t *);
+typedef void (*propertynotify_handler_func_t)(session_t *const, client_t *, xcb_get_property_reply_t *);
 
 /**
  * A structure to hold a PropertyNotify event handler function and related data.
@@ -88,12 +151,18 @@ static struct propertynotify_handler_t propertynotify_handlers[] = {
     { 0, 128, propertynotify_net_name },            // _NET_WM_NAME
     { 0, 128, propertynotify_name },                // WM_NAME
     { 0, UINT32_MAX, propertynotify_normal_hints }, // WM_NORMAL_HINTS
+    { 0, UINT32_MAX, propertynotify_hints },        // WM_HINTS
+    { 0, UINT32_MAX, propertynotify_protocols },    // WM_PROTOCOLS
+    { 0, 2, propertynotify_sync_counter },          // _NET_WM_SYNC_REQUEST_COUNTER
 };
 
 void event_propertynotify_handlers_init(void) {
     propertynotify_handlers[0].atom = ATOMS__NET_WM_NAME;
     propertynotify_handlers[1].atom = XCB_ATOM_WM_NAME;
     propertynotify_handlers[2].atom = XCB_ATOM_WM_NORMAL_HINTS;
+    propertynotify_handlers[3].atom = XCB_ATOM_WM_HINTS;
+    propertynotify_handlers[4].atom = ATOMS_WM_PROTOCOLS;
+    propertynotify_handlers[5].atom = ATOMS__NET_WM_SYNC_REQUEST_COUNTER;
 }
 
 /**
@@ -110,10 +179,24 @@ void event_handle(session_t *const session, xcb_generic_event_t *const ev) {
     // ignore highest bit, which is only set if the event was sent with SendEvent
     const uint8_t t = ev->response_type & ~0x80;
 
+    // any tracked requests sent before this event was generated have completed without error
+    errtable_retire(&session->errtable, ev->full_sequence);
+
+    record_time(session, ev, t);
+
     switch (t) {
+        case 0:
+            handle_error(session, (xcb_generic_error_t *)ev);
+            return;
         case XCB_BUTTON_PRESS:
             handle_button_press(session, (xcb_button_press_event_t *)ev);
             return;
+        case XCB_BUTTON_RELEASE:
+            handle_button_release(session, (xcb_button_release_event_t *)ev);
+            return;
+        case XCB_MOTION_NOTIFY:
+            handle_motion_notify(session, (xcb_motion_notify_event_t *)ev);
+            return;
         case XCB_UNMAP_NOTIFY:
             handle_unmap_notify(session, (xcb_unmap_notify_event_t *)ev);
             return;
@@ -123,50 +206,110 @@ void event_handle(session_t *const session, xcb_generic_event_t *const ev) {
         case XCB_CONFIGURE_REQUEST:
             handle_configure_request(session, (xcb_configure_request_event_t *)ev);
             return;
+        case XCB_FOCUS_IN:
+            handle_focus_in(session, (xcb_focus_in_event_t *)ev);
+            return;
+        case XCB_FOCUS_OUT:
+            handle_focus_out(session, (xcb_focus_out_event_t *)ev);
+            return;
         case XCB_PROPERTY_NOTIFY:
             handle_property_notify(session, (xcb_property_notify_event_t *)ev);
             return;
         case XCB_CLIENT_MESSAGE:
             handle_client_message(session, (xcb_client_message_event_t *)ev);
             return;
+        default:
+            // extension events
+            if (session->syncbase && t == (uint8_t)(session->syncbase + XCB_SYNC_ALARM_NOTIFY)) {
+                drag_handle_alarm(session, (xcb_sync_alarm_notify_event_t *)ev);
+            }
+            return;
+    }
+}
+
+static void record_time(session_t *const session, const xcb_generic_event_t *const ev, const uint8_t t) {
+    switch (t) {
+        // key, button, motion and crossing events share their layout up to the timestamp
+        case XCB_KEY_PRESS:
+        case XCB_KEY_RELEASE:
+        case XCB_BUTTON_PRESS:
+        case XCB_BUTTON_RELEASE:
+        case XCB_MOTION_NOTIFY:
+        case XCB_ENTER_NOTIFY:
+        case XCB_LEAVE_NOTIFY:
+            session->lasttime = ((const xcb_button_press_event_t *)ev)->time;
+            return;
+        case XCB_PROPERTY_NOTIFY:
+            session->lasttime = ((const xcb_property_notify_event_t *)ev)->time;
+            return;
         default:
             return;
     }
 }
 
+static void handle_error(session_t *const session, xcb_generic_error_t *const err) {
+    errtable_entry_t entry;
+
+    if (!errtable_take(&session->errtable, err->full_sequence, &entry)) {
+        LERR("X error %u (%s) from request %u (%s), minor %u, resource 0x%08x", err->error_code, xerrcode_str(err->error_code), err->full_sequence,
+            xrequest_str(err->major_code), err->minor_code, err->resource_id);
+        return;
+    }
+
+    LERR("When %s (client 0x%08x): error %u (%s)", entry.op, entry.client, err->error_code, xerrcode_str(err->error_code));
+
+    if (entry.handler) {
+        entry.handler(session, &entry, err);
+    }
+}
+
 static void handle_button_press(session_t *const session, xcb_button_press_event_t *const ev) {
     const xcb_window_t win = ev->event;
 
     xcb_connection_t *const con = session->con;
-    const clientset_t clientset = session->clientset;
-    client_t *client;
 
-    uint8_t is_frame = 1;
     uint8_t drag;
 
-    // attempt to get window client
-    client = htable_u32_get(clientset.byframe_ht, win, NULL);
-    if (!client) {
-        client = htable_u32_get(clientset.byinner_ht, win, NULL);
-        is_frame = 0;
+    // pressing another button ends a drag in progress
+    if (session->drag.active) {
+        drag_end(session);
+        return;
     }
+
+    // attempt to get window client
+    const clientref_t ref = clientset_find(&session->clientset, win);
+    client_t *const client = ref.client;
     if (!client) {
         // not managed
         return;
     }
+    const uint8_t is_frame = (ref.role == CLIENT_ROLE_FRAME || CLIENT_ROLE_IS_GRIP(ref.role));
 
-    client_focus(con, client);
-    client_raise(con, client);
+    client_focus(session, client, ev->time);
+    client_raise(session, client);
 
-    // init drag if clicking on frame, or if meta dragging is enabled and being done
+    // init drag if clicking on frame (or one of its resize grips), or if meta dragging is enabled and being done
     drag = is_frame || (session->cfg.drag_n_drop.meta_dragging && (ev->state & XCB_MOD_MASK_4));
     if (drag && ev->detail == XCB_BUTTON_INDEX_1) { // only drag-n-drop when holding LMB
-        drag_start_and_wait(session, client, event_handle);
+        // the drag is advanced by later events, as they are dispatched
+        drag_start(session, client, ref.role, ev);
+        return;
     }
 
     // propagate click events to client so the application can process them as usual
     xcb_allow_events(con, XCB_ALLOW_REPLAY_POINTER, ev->time);
-    xcb_flush(con);
+    session_defer_flush(session);
+}
+
+static void handle_button_release(session_t *const session, xcb_button_release_event_t *const ev) {
+    // suppress unused parameter
+    (void)ev;
+
+    drag_end(session);
+}
+
+static void handle_motion_notify(session_t *const session, xcb_motion_notify_event_t *const ev) {
+    drag_handle_motion(session, ev);
 }
 
 static void handle_unmap_notify(session_t *const session, xcb_unmap_notify_event_t *const ev) {
@@ -175,7 +318,7 @@ static void handle_unmap_notify(session_t *const session, xcb_unmap_notify_event
 
     xcb_connection_t *const con = session->con;
     const xcb_window_t root = session->root;
-    const clientset_t clientset = session->clientset;
+    const clientset_t *const clientset = &session->clientset;
 
     // if the window's parent is the root window, then we know that win is a frame or hasnt been reparented/managed
     if (parent == root) {
@@ -183,18 +326,13 @@ static void handle_unmap_notify(session_t *const session, xcb_unmap_notify_event
     }
 
     // otherwise, we assume that win is an inner so get its client by that handle
-    client_t *client = htable_u32_get(clientset.byinner_ht, win, NULL);
+    client_t *client = clientset_find_role(clientset, win, CLIENT_ROLE_INNER);
     if (!client) {
         return;
     }
 
-    // destroy frame (note this does not destroy the inner window, which instead is reparented to root)
-    client_frame_destroy(con, client, root);
-
-    // unmanage the client: remove all references to it and then free it
-    htable_u32_pop(clientset.byinner_ht, win, NULL);
-    htable_u32_pop(clientset.byframe_ht, parent, NULL);
-    client_dealloc(client);
+    // unmanage the client (destroying its frame) - the inner window is not destroyed, but reparented to root
+    session_unmanage_client(session, client);
 
     // the EWMH specification dictates that _NET_WM_STATE and _NET_WM_DESKTOP atoms are deleted from withdrawn (unmapped) windows
     // TODO: if/when _NET_WM_DESKTOP is implemented: xcb_delete_property(con, win, ATOMS__NET_WM_DESKTOP)
@@ -205,6 +343,7 @@ static void handle_unmap_notify(session_t *const session, xcb_unmap_notify_event
         (uint32_t[]){
             XCB_ICCCM_WM_STATE_WITHDRAWN
         });
+    session_defer_flush(session);
 }
 
 static void handle_map_request(session_t *const session, xcb_map_request_event_t *const ev) {
@@ -214,12 +353,12 @@ static void handle_map_request(session_t *const session, xcb_map_request_event_t
     client_t *client;
 
     // we intercept map requests in order to frame the window before mapping it
-    if (!(client = session_manage_client(session, win))) {
+    if (!(client = session_manage_client(session, win, NULL))) {
         LERR("MapRequest for 0x%08x: Failed to manage client", win);
     }
 
     xcb_map_window(con, win);
-    xcb_flush(con);
+    session_defer_flush(session);
 
     // don't proceed if we failed to make the client
     if (!client) {
@@ -228,8 +367,9 @@ static void handle_map_request(session_t *const session, xcb_map_request_event_t
 
     // focus and raise new clients
     // TODO: check if this needs to depend on a window hint, some windows might want to not open on top?
-    client_focus(con, client);
-    client_raise(con, client);
+    // (ICCCM forbids CurrentTime in WM_TAKE_FOCUS messages, so the latest known server time is used)
+    client_focus(session, client, session->lasttime);
+    client_raise(session, client);
 }
 
 static void handle_configure_request(session_t *const session, xcb_configure_request_event_t *const ev) {
@@ -237,14 +377,11 @@ static void handle_configure_request(session_t *const session, xcb_configure_req
     const uint16_t evmask = ev->value_mask;
 
     xcb_connection_t *const con = session->con;
-    const clientset_t clientset = session->clientset;
+    const clientset_t *const clientset = &session->clientset;
     client_t *client;
 
-    offset_t newpos = { ev->x, ev->y };
-    extent_t newsize = { ev->width, ev->height };
-
     // attempt to get client by window handle; if NULL, we assume this window isn't managed and therefore (in practice) not yet mapped
-    if (!(client = htable_u32_get(clientset.byinner_ht, win, NULL))) {
+    if (!(client = clientset_find_role(clientset, win, CLIENT_ROLE_INNER))) {
         // pass configure event along as normal
         uint16_t mask = 0;
         uint32_t values[7];
@@ -260,23 +397,76 @@ static void handle_configure_request(session_t *const session, xcb_configure_req
         COPY_MASK_MEMBER(XCB_CONFIG_WINDOW_Y, y);
         COPY_MASK_MEMBER(XCB_CONFIG_WINDOW_WIDTH, width);
         COPY_MASK_MEMBER(XCB_CONFIG_WINDOW_HEIGHT, height);
-        COPY_MASK_MEMBER(XCB_CONFIG_WINDOW_SIBLING, sibling);
-        COPY_MASK_MEMBER(XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
-#       undef COPY_MASK_MEMBER
 
-        // set border width to 0
+        // set border width to 0 (values are listed in mask bit order, so this goes before the sibling and stack mode)
         mask |= XCB_CONFIG_WINDOW_BORDER_WIDTH;
         values[c++] = 0;
 
+        COPY_MASK_MEMBER(XCB_CONFIG_WINDOW_SIBLING, sibling);
+        COPY_MASK_MEMBER(XCB_CONFIG_WINDOW_STACK_MODE, stack_mode);
+#       undef COPY_MASK_MEMBER
+
         xcb_configure_window(con, win, mask, values);
-        xcb_flush(con);
+        session_defer_flush(session);
 
         return;
     }
 
-    // update geometry
-    clientprops_set_pos(con, client, newpos);
-    clientprops_set_size(con, client, newsize);
+    // only the requested parts of the geometry change
+    rect_t rect = client->properties.rect;
+    if (evmask & XCB_CONFIG_WINDOW_X)       rect.offset.x = ev->x;
+    if (evmask & XCB_CONFIG_WINDOW_Y)       rect.offset.y = ev->y;
+    if (evmask & XCB_CONFIG_WINDOW_WIDTH)   rect.extent.width = ev->width;
+    if (evmask & XCB_CONFIG_WINDOW_HEIGHT)  rect.extent.height = ev->height;
+
+    // update geometry in one transaction (the client is told about the result even if nothing changed)
+    clientprops_apply(session, client, rect);
+}
+
+static void handle_focus_in(session_t *const session, xcb_focus_in_event_t *const ev) {
+    if (!focus_event_is_real(ev)) {
+        return;
+    }
+
+    // focus events are only selected on inner windows
+    client_t *const client = clientset_find_role(&session->clientset, ev->event, CLIENT_ROLE_INNER);
+    if (!client) {
+        return;
+    }
+
+    // a client took focus by itself (e.g. a 'Globally Active' client, or a focus change we caused) - there is no need to set it again
+    client_set_focused(session, client);
+}
+
+static void handle_focus_out(session_t *const session, xcb_focus_out_event_t *const ev) {
+    if (!focus_event_is_real(ev)) {
+        return;
+    }
+
+    client_t *const client = clientset_find_role(&session->clientset, ev->event, CLIENT_ROLE_INNER);
+    if (!client || clientset_get(&session->clientset, session->focused) != client) {
+        // focus moving away from a client we already consider unfocused (e.g. because we moved it to another client)
+        return;
+    }
+
+    // if focus moved to another client, that will be recorded when its FocusIn event arrives
+    client_set_focused(session, NULL);
+}
+
+static uint8_t focus_event_is_real(const xcb_focus_in_event_t *const ev) {
+    if (ev->mode == XCB_NOTIFY_MODE_GRAB || ev->mode == XCB_NOTIFY_MODE_UNGRAB) {
+        return 0;
+    }
+
+    switch (ev->detail) {
+        case XCB_NOTIFY_DETAIL_INFERIOR:
+        case XCB_NOTIFY_DETAIL_POINTER:
+        case XCB_NOTIFY_DETAIL_POINTER_ROOT:
+        case XCB_NOTIFY_DETAIL_NONE:
+            return 0;
+        default:
+            return 1;
+    }
 }
 
 static void handle_property_notify(session_t *const session, xcb_property_notify_event_t *const ev) {
@@ -285,7 +475,12 @@ static void handle_property_notify(session_t *const session, xcb_property_notify
     const uint8_t state = ev->state;
 
     xcb_connection_t *const con = session->con;
-    const clientset_t clientset = session->clientset;
+    const clientset_t *const clientset = &session->clientset;
+
+    // property changes on root are only selected for their timestamps
+    if (win == session->root) {
+        return;
+    }
 
     const struct propertynotify_handler_t *handler = NULL;
     const uint32_t handlern = sizeof(propertynotify_handlers) / sizeof(struct propertynotify_handler_t);
@@ -306,7 +501,7 @@ static void handle_property_notify(session_t *const session, xcb_property_notify
     }
 
     // we are not notified of property changes on frames, so we assume win is an inner window
-    client_t *client = htable_u32_get(clientset.byinner_ht, win, NULL);
+    client_t *client = clientset_find_role(clientset, win, CLIENT_ROLE_INNER);
     if (!client) {
         LWARN("Recieved property change of atom %d on unmanaged window", atom);
         return;
@@ -322,25 +517,46 @@ static void handle_property_notify(session_t *const session, xcb_property_notify
         }
     }
 
-    handler->func(con, client, prop);
+    handler->func(session, client, prop);
 }
 
-static void propertynotify_net_name(xcb_connection_t *const con, client_t *client, xcb_get_property_reply_t *prop) {
+static void propertynotify_net_name(session_t *const session, client_t *client, xcb_get_property_reply_t *prop) {
     // suppress unused parameter
-    (void)con;
+    (void)session;
 
     clientprops_update_net_name(client, prop);
 }
 
-static void propertynotify_name(xcb_connection_t *const con, client_t *client, xcb_get_property_reply_t *prop) {
+static void propertynotify_name(session_t *const session, client_t *client, xcb_get_property_reply_t *prop) {
     // suppress unused parameter
-    (void)con;
+    (void)session;
 
     clientprops_update_name(client, prop);
 }
 
-static void propertynotify_normal_hints(xcb_connection_t *const con, client_t *client, xcb_get_property_reply_t *prop) {
-    clientprops_update_normal_hints(con, client, prop, NULL);
+static void propertynotify_normal_hints(session_t *const session, client_t *client, xcb_get_property_reply_t *prop) {
+    clientprops_update_normal_hints(session, client, prop, NULL);
+}
+
+static void propertynotify_hints(session_t *const session, client_t *client, xcb_get_property_reply_t *prop) {
+    // suppress unused parameter
+    (void)session;
+
+    clientprops_update_hints(client, prop);
+}
+
+static void propertynotify_protocols(session_t *const session, client_t *client, xcb_get_property_reply_t *prop) {
+    // suppress unused parameter
+    (void)session;
+
+    clientprops_update_protocols(client, prop);
+}
+
+static void propertynotify_sync_counter(session_t *const session, client_t *client, xcb_get_property_reply_t *prop) {
+    // suppress unused parameter
+    (void)session;
+
+    clientprops_update_sync_counter(client, prop);
 }
 
 static void handle_client_message(session_t *const session, xcb_client_message_event_t *const ev) {
@@ -349,7 +565,7 @@ static void handle_client_message(session_t *const session, xcb_client_message_e
     const uint8_t format = ev->format;
 
     xcb_connection_t *const con = session->con;
-    const clientset_t clientset = session->clientset;
+    const clientset_t *const clientset = &session->clientset;
 
     if (type == ATOMS__NET_WM_STATE) {
         // responding to a window state change
@@ -358,7 +574,7 @@ static void handle_client_message(session_t *const session, xcb_client_message_e
             return;
         }
 
-        client_t *const client = htable_u32_get(clientset.byinner_ht, win, NULL);
+        client_t *const client = clientset_find_role(clientset, win, CLIENT_ROLE_INNER);
         if (!client) {
             LWARN("Recieved ClientMessage of type _NET_WM_STATE on unmanaged window");
             return;
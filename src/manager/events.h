@@ -24,11 +24,6 @@ typedef struct session_t session_t;
  */
 void event_propertynotify_handlers_init(void);
 
-/**
- * Pointer to a function that takes an event and handles it accordingly.
- */
-typedef void (*eventhandler_t)(session_t *const, xcb_generic_event_t *const);
-
 /**
  * Call the appropriate event handler callback function depending on the type of event given.
  */
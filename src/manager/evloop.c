@@ -0,0 +1,139 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#include "evloop.h"
+
+#include "util/logging.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/**
+ * Maximum amount of ready sources dispatched per `evloop_wait()` call.
+ */
+#define EVLOOP_MAX_READY 16
+
+evloop_t evloop_init(void) {
+    evloop_t loop;
+
+    loop.running = 0;
+    loop.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop.epfd < 0) {
+        LERR("epoll_create1() fault (errno %d)", errno);
+    }
+
+    return loop;
+}
+
+void evloop_dealloc(evloop_t *const loop) {
+    if (loop->epfd >= 0) {
+        close(loop->epfd);
+    }
+
+    loop->epfd = -1;
+    loop->running = 0;
+}
+
+uint8_t evloop_add(evloop_t *const loop, evloop_source_t *const src) {
+    struct epoll_event ev = {
+        .events = EPOLLIN,
+        .data.ptr = src
+    };
+
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, src->fd, &ev) < 0) {
+        LERR("Failed to add fd %d to event loop (errno %d)", src->fd, errno);
+        return 0;
+    }
+
+    return 1;
+}
+
+void evloop_remove(evloop_t *const loop, evloop_source_t *const src) {
+    if (epoll_ctl(loop->epfd, EPOLL_CTL_DEL, src->fd, NULL) < 0) {
+        LERR("Failed to remove fd %d from event loop (errno %d)", src->fd, errno);
+    }
+}
+
+void evloop_wait(evloop_t *const loop, const int32_t timeout) {
+    struct epoll_event ready[EVLOOP_MAX_READY];
+    int n;
+
+    n = epoll_wait(loop->epfd, ready, EVLOOP_MAX_READY, timeout);
+    if (n < 0) {
+        if (errno != EINTR) {
+            LERR("epoll_wait() fault (errno %d)", errno);
+        }
+        return;
+    }
+
+    for (int i = 0; i < n; i++) {
+        evloop_source_t *const src = ready[i].data.ptr;
+
+        if (src->is_timer) {
+            // reading the expiration count clears the timer's readability
+            uint64_t expirations;
+            if (read(src->fd, &expirations, sizeof(expirations)) < 0) {
+                // (may have been disarmed by an earlier callback in this iteration)
+                continue;
+            }
+        }
+
+        src->cb(src, src->data);
+    }
+}
+
+uint8_t evloop_timer_init(evloop_t *const loop, evloop_source_t *const timer, const evloop_callback_t cb, void *const data) {
+    *timer = (evloop_source_t){
+        .fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC),
+        .cb = cb,
+        .data = data,
+        .is_timer = 1
+    };
+
+    if (timer->fd < 0) {
+        LERR("timerfd_create() fault (errno %d)", errno);
+        return 0;
+    }
+
+    if (!evloop_add(loop, timer)) {
+        close(timer->fd);
+        timer->fd = -1;
+        return 0;
+    }
+
+    return 1;
+}
+
+void evloop_timer_dealloc(evloop_t *const loop, evloop_source_t *const timer) {
+    if (timer->fd < 0) {
+        return;
+    }
+
+    evloop_remove(loop, timer);
+    close(timer->fd);
+
+    timer->fd = -1;
+}
+
+void evloop_timer_arm(evloop_source_t *const timer, const uint64_t ns, const uint64_t interval) {
+    const struct itimerspec its = {
+        .it_interval = {
+            .tv_sec = interval / 1000000000,
+            .tv_nsec = interval % 1000000000
+        },
+        .it_value = {
+            .tv_sec = ns / 1000000000,
+            .tv_nsec = ns % 1000000000
+        }
+    };
+
+    if (timerfd_settime(timer->fd, 0, &its, NULL) < 0) {
+        LERR("timerfd_settime() fault (errno %d)", errno);
+    }
+}
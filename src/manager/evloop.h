@@ -0,0 +1,116 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#pragma once
+#ifndef __awm__evloop_h
+#define __awm__evloop_h
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <stdint.h>
+
+typedef struct evloop_source_t evloop_source_t;
+
+/**
+ * Pointer to a function called when a source's file descriptor is ready to be read from.
+ */
+typedef void (*evloop_callback_t)(evloop_source_t *const, void *const);
+
+/**
+ * A file descriptor watched by an event loop, and the callback to dispatch when it becomes readable.
+ */
+typedef struct evloop_source_t {
+    /** Watched file descriptor */
+    int fd;
+    /** Callback function */
+    evloop_callback_t cb;
+    /** User data passed to the callback */
+    void *data;
+    /** 1 if `fd` is a timerfd, in which case its expiration count is read before the callback is called */
+    uint8_t is_timer;
+} evloop_source_t;
+
+/**
+ * An epoll-based event loop, dispatching all file descriptor sources (X connection, signals, timers, etc) from one place.
+ */
+typedef struct evloop_t {
+    /** epoll instance file descriptor */
+    int epfd;
+    /** Set to 0 to make `evloop_wait()` callers stop iterating */
+    uint8_t running;
+} evloop_t;
+
+/**
+ * Create a new event loop. `epfd` is set to -1 if there was an error.
+ */
+evloop_t evloop_init(void);
+
+/**
+ * Close the given event loop. Sources are not closed.
+ */
+void evloop_dealloc(
+    evloop_t *const loop
+);
+
+/**
+ * Start watching `src` for readability. `src` must remain valid until it is removed or the loop is deallocated. Return 0 if there is an error.
+ */
+uint8_t evloop_add(
+    evloop_t *const loop,
+    evloop_source_t *const src
+);
+
+/**
+ * Stop watching `src`.
+ */
+void evloop_remove(
+    evloop_t *const loop,
+    evloop_source_t *const src
+);
+
+/**
+ * Wait up to `timeout` milliseconds (or indefinitely if negative) for any sources to become ready, and dispatch their callbacks.
+ */
+void evloop_wait(
+    evloop_t *const loop,
+    const int32_t timeout
+);
+
+/**
+ * Initialise `timer` as a timer source (unarmed) on a new timerfd, and start watching it. As with `evloop_add()`, `timer` must remain valid while it
+ * is being watched. Return 0 if there is an error, in which case `fd` is set to -1.
+ */
+uint8_t evloop_timer_init(
+    evloop_t *const loop,
+    evloop_source_t *const timer,
+    const evloop_callback_t cb,
+    void *const data
+);
+
+/**
+ * Stop watching the given timer and close it.
+ */
+void evloop_timer_dealloc(
+    evloop_t *const loop,
+    evloop_source_t *const timer
+);
+
+/**
+ * Arm `timer` to first expire after `ns` nanoseconds, and then every `interval` nanoseconds (or just once if `interval` is 0). If `ns` is 0, the
+ * timer is disarmed instead.
+ */
+void evloop_timer_arm(
+    evloop_source_t *const timer,
+    const uint64_t ns,
+    const uint64_t interval
+);
+
+#ifdef __cplusplus
+    }
+#endif
+#endif
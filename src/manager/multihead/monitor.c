@@ -12,57 +12,51 @@
 
 #include <stdlib.h>
 
-monitor_t monitor_init(xcb_connection_t *const con, const xcb_randr_output_t output, const xcb_timestamp_t tstamp) {
+/**
+ * Calculate the refresh rate (in millihertz) of the given RandR mode.
+ */
+static uint32_t mode_refresh_rate(
+    const xcb_randr_mode_info_t *const mode
+);
+
+monitor_t monitor_init(const xcb_randr_output_t output, const xcb_randr_get_output_info_reply_t *const outputinfo,
+    const xcb_randr_get_crtc_info_reply_t *const crtcinfo, const xcb_randr_mode_info_t *const modes, const uint32_t moden)
+{
     monitor_t m;
     m.output = output;
-    m.next = NULL;
-
-    xcb_randr_get_output_info_reply_t *outputinfo;
-    xcb_randr_get_crtc_info_reply_t *crtcinfo;
-
-    xcb_randr_crtc_t crtc;
-
-    // get output info
-    outputinfo = xcb_randr_get_output_info_reply(con,
-        xcb_randr_get_output_info(con, output, tstamp), NULL);
-    if (!outputinfo) {
-        goto out2;
-    }
-
-    crtc = outputinfo->crtc;
-
-    // get crtc info from the output
-    crtcinfo = xcb_randr_get_crtc_info_reply(con,
-        xcb_randr_get_crtc_info(con, crtc, tstamp), NULL);
-    if (!crtcinfo) {
-        goto out1;
-    }
+    m.refresh = 0;
 
     m.dims.extent.width = crtcinfo->width;
     m.dims.extent.height = crtcinfo->height;
     m.dims.offset.x = crtcinfo->x;
     m.dims.offset.y = crtcinfo->y;
 
+    // find the crtc's current mode to get the refresh rate
+    for (uint32_t i = 0; i < moden; i++) {
+        if (modes[i].id == crtcinfo->mode) {
+            m.refresh = mode_refresh_rate(&modes[i]);
+            break;
+        }
+    }
+
     // printing monitor information in debug context
     const char *const name = (const char *) xcb_randr_get_output_info_name(outputinfo);
     LLOG(
         "New monitor: output 0x%08x\n"
         "\tname = \"%s\"\n"
-        "\tdims = %ux%u+%d+%u",
+        "\tdims = %ux%u+%d+%u\n"
+        "\trefresh = %u.%03u Hz",
         output, name,
-        m.dims.extent.width, m.dims.extent.height, m.dims.offset.x, m.dims.offset.y);
+        m.dims.extent.width, m.dims.extent.height, m.dims.offset.x, m.dims.offset.y,
+        m.refresh / 1000, m.refresh % 1000);
 
-    free(crtcinfo);
-out1:
-    free(outputinfo);
-out2:
     return m;
 }
 
 monitor_t monitor_init_xinerama(const xcb_xinerama_screen_info_t *info) {
     monitor_t m;
     m.output = UINT32_MAX;
-    m.next = NULL;
+    m.refresh = 0; // (xinerama doesn't know about modes)
 
     m.dims = (rect_t){
         .extent = {
@@ -83,3 +77,21 @@ monitor_t monitor_init_xinerama(const xcb_xinerama_screen_info_t *info) {
 
     return m;
 }
+
+static uint32_t mode_refresh_rate(const xcb_randr_mode_info_t *const mode) {
+    uint64_t vtotal = mode->vtotal;
+
+    // scanlines are drawn twice with doublescan, and interlaced modes draw half of them per field
+    if (mode->mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN) {
+        vtotal *= 2;
+    }
+    if (mode->mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE) {
+        vtotal /= 2;
+    }
+
+    if (!mode->htotal || !vtotal) {
+        return 0;
+    }
+
+    return (uint32_t)(((uint64_t)mode->dot_clock * 1000) / (mode->htotal * vtotal));
+}
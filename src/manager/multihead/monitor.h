@@ -19,7 +19,7 @@
 #include <xcb/xinerama.h>
 
 /**
- * Data for a display monitor, indexed by RandR -- part of a singly linked list of monitors.
+ * Data for a display monitor, indexed by RandR.
  */
 typedef struct monitor_t {
     /** Corresponding output ID in RandR */
@@ -27,18 +27,20 @@ typedef struct monitor_t {
 
     /** Monitor dimensions and positional offset data */
     rect_t dims;
-
-    /** Next monitor ptr in list */
-    struct monitor_t *next;
+    /** Refresh rate of the monitor's current mode in millihertz, or 0 if unknown */
+    uint32_t refresh;
 } monitor_t;
 
 /**
- * Create monitor from given output
+ * Create monitor from given output, using its output info and the info of its CRTC as already queried from RandR. The refresh rate is found by looking
+ * up the CRTC's mode in `modes` (of length `moden`), as listed in the screen resources.
  */
 monitor_t monitor_init(
-    xcb_connection_t *const con,
     const xcb_randr_output_t output,
-    const xcb_timestamp_t tstamp
+    const xcb_randr_get_output_info_reply_t *const outputinfo,
+    const xcb_randr_get_crtc_info_reply_t *const crtcinfo,
+    const xcb_randr_mode_info_t *const modes,
+    const uint32_t moden
 );
 
 /**
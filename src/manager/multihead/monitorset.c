@@ -10,57 +10,172 @@
 #include "manager/multihead/monitor.h"
 #include "util/logging.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+/**
+ * Returns 1 if `rect` contains the point `p`.
+ */
+static uint8_t rect_contains(
+    const rect_t rect,
+    const offset_t p
+);
+
+/**
+ * Get the distance from point `p` to the nearest point in `rect` (i.e. the larger of the horizontal and vertical distances).
+ */
+static uint64_t rect_distance(
+    const rect_t rect,
+    const offset_t p
+);
+
 monitorset_t monitorset_init(void) {
     monitorset_t set;
-    set.byoutput_ht = htable_u32_new();
-    set.listhead = NULL;
+    memset(&set, 0, sizeof(monitorset_t));
 
     return set;
 }
 
 void monitorset_dealloc(monitorset_t *const set) {
-    // free monitors by linked list
-    monitor_t *cur = set->listhead;
-    monitor_t *next;
-    while (cur) {
-        next = cur->next;
-        free(cur);
-        cur = next;
+    free(set->monitors);
+
+    memset(set, 0, sizeof(monitorset_t));
+}
+
+void monitorset_clear(monitorset_t *const set) {
+    set->len = 0;
+    set->maxwidth = 0;
+}
+
+uint8_t monitorset_push(monitorset_t *const set, const monitor_t *const monitor) {
+    if (set->len >= set->cap) {
+        const uint32_t cap = (set->cap) ? set->cap << 1 : 4;
+
+        monitor_t *const monitors = realloc(set->monitors, sizeof(monitor_t) * cap);
+        if (!monitors) {
+            LERR("realloc() fault when adding monitor to set");
+            return 0;
+        }
+
+        set->monitors = monitors;
+        set->cap = cap;
     }
 
-    htable_u32_t *const ht = set->byoutput_ht;
-    if (ht) {
-        htable_u32_free(ht, NULL);
+    // insertion sort by x offset (there are only ever a handful of monitors)
+    uint32_t i = set->len;
+    while (i > 0 && set->monitors[i - 1].dims.offset.x > monitor->dims.offset.x) {
+        set->monitors[i] = set->monitors[i - 1];
+        i--;
     }
+    set->monitors[i] = *monitor;
+    set->len++;
 
-    memset(set, 0, sizeof(monitorset_t));
+    if (monitor->dims.extent.width > set->maxwidth) {
+        set->maxwidth = monitor->dims.extent.width;
+    }
+
+    return 1;
+}
+
+monitor_t *monitorset_get(const monitorset_t *const set, const uint32_t idx) {
+    if (idx >= set->len) {
+        return NULL;
+    }
+
+    return &set->monitors[idx];
+}
+
+uint32_t monitorset_index_of(const monitorset_t *const set, const monitor_t *const monitor) {
+    for (uint32_t i = 0; i < set->len; i++) {
+        const monitor_t *const cur = &set->monitors[i];
+
+        if (monitor->output != UINT32_MAX) {
+            if (cur->output == monitor->output) {
+                return i;
+            }
+        } else if (memcmp(&cur->dims, &monitor->dims, sizeof(rect_t)) == 0) {
+            return i;
+        }
+    }
+
+    return MONITORSET_INDEX_NONE;
 }
 
-uint8_t monitorset_push(monitorset_t *const set, monitor_t *const monitor) {
-    // push to front of list
-    monitor->next = set->listhead;
-    set->listhead = monitor;
+uint32_t monitorset_index_at(const monitorset_t *const set, const offset_t p) {
+    const monitor_t *const monitors = set->monitors;
 
-    htable_u32_t *const ht = set->byoutput_ht;
-    const uint32_t key = (uint32_t)monitor->output;
+    // find the first monitor starting right of p - only monitors before it can contain p
+    uint32_t lo = 0, hi = set->len;
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
 
-    if (key == UINT32_MAX) {
-        // key is set to max on monitors created from Xinerama, so output isnt valid, and so we don't add it to the byoutput htable
-        return 1;
+        if (monitors[mid].dims.offset.x <= p.x) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
 
-    const htable_err_t err = htable_u32_set(ht, key, (void *) monitor);
+    // scan back through monitors that are close enough to p to reach it
+    for (uint32_t i = lo; i > 0; i--) {
+        const rect_t d = monitors[i - 1].dims;
 
-    if (!err) {
-        // no errors
-        return 1;
+        if ((int64_t)d.offset.x + set->maxwidth <= p.x) {
+            break;
+        }
+        if (rect_contains(d, p)) {
+            return i - 1;
+        }
     }
 
-    if (err & HTE_EXIST) {
-        LERR("Failed to add monitor to set: output (0x%08x) already exists in the htable", key);
+    return MONITORSET_INDEX_NONE;
+}
+
+uint32_t monitorset_index_by_point(const monitorset_t *const set, const offset_t p) {
+    const uint32_t idx = monitorset_index_at(set, p);
+    if (idx != MONITORSET_INDEX_NONE) {
+        return idx;
     }
 
-    return 0;
+    // p is off-screen, so fall back to the nearest monitor
+    uint32_t nearest = MONITORSET_INDEX_NONE;
+    uint64_t nearestdist = UINT64_MAX;
+
+    for (uint32_t i = 0; i < set->len; i++) {
+        const uint64_t dist = rect_distance(set->monitors[i].dims, p);
+
+        if (dist < nearestdist) {
+            nearest = i;
+            nearestdist = dist;
+        }
+    }
+
+    return nearest;
+}
+
+uint32_t monitorset_track_point(const monitorset_t *const set, const uint32_t hint, const offset_t p) {
+    if (hint < set->len && rect_contains(set->monitors[hint].dims, p)) {
+        return hint;
+    }
+
+    return monitorset_index_by_point(set, p);
+}
+
+monitor_t *monitorset_find_by_point(const monitorset_t *const set, const offset_t p) {
+    return monitorset_get(set, monitorset_index_by_point(set, p));
+}
+
+static uint8_t rect_contains(const rect_t rect, const offset_t p) {
+    return p.x >= rect.offset.x && (int64_t)p.x < (int64_t)rect.offset.x + rect.extent.width
+        && p.y >= rect.offset.y && (int64_t)p.y < (int64_t)rect.offset.y + rect.extent.height;
+}
+
+static uint64_t rect_distance(const rect_t rect, const offset_t p) {
+    const int64_t x0 = rect.offset.x, x1 = x0 + rect.extent.width,
+                  y0 = rect.offset.y, y1 = y0 + rect.extent.height;
+
+    const int64_t dx = (p.x < x0) ? x0 - p.x : ((p.x >= x1) ? p.x - x1 + 1 : 0);
+    const int64_t dy = (p.y < y0) ? y0 - p.y : ((p.y >= y1) ? p.y - y1 + 1 : 0);
+
+    return (uint64_t)((dx > dy) ? dx : dy);
 }
@@ -12,18 +12,32 @@
     extern "C" {
 #endif
 
-#include "htable/htable.h"
+#include "data/rect.h"
+
+#include <stdint.h>
 
 typedef struct monitor_t monitor_t;
 
 /**
- * A structure containing a set of references to monitors.
+ * Monitor index signifying no monitor.
+ */
+#define MONITORSET_INDEX_NONE UINT32_MAX
+
+/**
+ * A structure containing a set of monitors.
+ *
+ * Monitors are stored by value in a flat array, sorted by their left edge: a point lookup is a binary search for the monitors starting left of the
+ * point, followed by a scan back through those that are wide enough to reach it.
  */
 typedef struct monitorset_t {
-    /** Table of monitors in the set, indexed by their output id */
-    htable_u32_t *byoutput_ht;
-    /** Linked list of monitors in the set. This is maintained in case of monitors that can't be indexed by output, e.g. those from Xinerama. */
-    monitor_t *listhead;
+    /** Monitors in the set, sorted by x offset */
+    monitor_t *monitors;
+    /** Amount of monitors in the set */
+    uint32_t len;
+    /** Capacity of `monitors` */
+    uint32_t cap;
+    /** Width of the widest monitor in the set */
+    uint32_t maxwidth;
 } monitorset_t;
 
 /**
@@ -39,11 +53,71 @@ void monitorset_dealloc(
 );
 
 /**
- * Add `monitor` to monitor store `set`. Return 0 if there is an error.
+ * Remove all monitors from `set`. Note that this invalidates monitor indices and pointers into the set.
+ */
+void monitorset_clear(
+    monitorset_t *const set
+);
+
+/**
+ * Add a copy of `monitor` to monitor store `set`. Return 0 if there is an error.
+ * Note that this invalidates monitor indices and pointers into the set.
  */
 uint8_t monitorset_push(
     monitorset_t *const set,
-    monitor_t *const monitor
+    const monitor_t *const monitor
+);
+
+/**
+ * Get the monitor at index `idx` in `set`, or NULL if there is no such monitor.
+ */
+monitor_t *monitorset_get(
+    const monitorset_t *const set,
+    const uint32_t idx
+);
+
+/**
+ * Get the index of the monitor in `set` that is the same monitor as `monitor` (i.e. has the same RandR output; monitors without an output, e.g.
+ * those from Xinerama, are matched by their dimensions), or `MONITORSET_INDEX_NONE` if there is no such monitor.
+ */
+uint32_t monitorset_index_of(
+    const monitorset_t *const set,
+    const monitor_t *const monitor
+);
+
+/**
+ * Get the index of the monitor in `set` containing the point `p`, or `MONITORSET_INDEX_NONE` if no monitor contains it.
+ */
+uint32_t monitorset_index_at(
+    const monitorset_t *const set,
+    const offset_t p
+);
+
+/**
+ * Get the index of the monitor in `set` containing the point `p`. If no monitor contains it, then the index of the nearest monitor is returned (or
+ * `MONITORSET_INDEX_NONE` if the set is empty).
+ */
+uint32_t monitorset_index_by_point(
+    const monitorset_t *const set,
+    const offset_t p
+);
+
+/**
+ * Same as `monitorset_index_by_point()`, but checks the monitor at index `hint` first (e.g. the monitor a point was on when last checked), so a
+ * point that hasn't crossed onto another monitor is found in constant time.
+ */
+uint32_t monitorset_track_point(
+    const monitorset_t *const set,
+    const uint32_t hint,
+    const offset_t p
+);
+
+/**
+ * Get the monitor in `set` containing the point `p`. If no monitor contains it, then the nearest monitor is returned (or NULL if the set is empty).
+ */
+monitor_t *monitorset_find_by_point(
+    const monitorset_t *const set,
+    const offset_t p
 );
 
 #ifdef __cplusplus
@@ -19,24 +19,17 @@
 static uint8_t has_randr_1_5 = 0;
 
 static xcb_randr_output_t *randr_find_outputs_1_4(
-    xcb_connection_t *const con,
-    const xcb_window_t root,
+    const xcb_randr_get_screen_resources_current_reply_t *const res,
     uint32_t *const len,
     xcb_timestamp_t *const tstamp
 );
 static xcb_randr_output_t *randr_find_outputs_1_5(
     xcb_connection_t *const con,
-    const xcb_window_t root,
+    const xcb_randr_get_monitors_cookie_t cookie,
     uint32_t *const len,
     xcb_timestamp_t *const tstamp
 );
 
-static uint8_t validate_output(
-    xcb_connection_t *const con,
-    const xcb_randr_output_t output,
-    const xcb_timestamp_t tstamp
-);
-
 uint8_t randr_init(xcb_connection_t *const con, const xcb_window_t root, const uint8_t force_1_4) {
     xcb_generic_error_t *err;
 
@@ -50,13 +43,27 @@ uint8_t randr_init(xcb_connection_t *const con, const xcb_window_t root, const u
     }
     randrbase = randr->first_event;
 
+    // send the version query and event selection together, so both replies arrive in one round trip
+    xcb_randr_query_version_cookie_t vc = { 0 };
+    if (!force_1_4) {
+        vc = xcb_randr_query_version(con, XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION);
+    }
+
+    // request to recieve randr events
+    xcb_void_cookie_t c = xcb_randr_select_input_checked(
+        con, root,
+        (uint16_t)(
+            XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
+            XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE |
+            XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE));
+
     if (!force_1_4) {
         // check for minimum randr version 1.5
-        xcb_randr_query_version_reply_t *v = xcb_randr_query_version_reply(con,
-            xcb_randr_query_version(con, XCB_RANDR_MAJOR_VERSION, XCB_RANDR_MINOR_VERSION), &err);
+        xcb_randr_query_version_reply_t *v = xcb_randr_query_version_reply(con, vc, &err);
         if (err) {
             LERR("Failed to query RandR version (%s); falling back to Xinerama.", xerrcode_str(err->error_code));
             free(err);
+            xcb_discard_reply(con, c.sequence);
             return 0;
         }
         has_randr_1_5 = (v->major_version >= 1) && (v->minor_version >= 5);
@@ -67,19 +74,11 @@ uint8_t randr_init(xcb_connection_t *const con, const xcb_window_t root, const u
         LINFO("Using RandR <=1.4");
     }
 
-    // request to recieve randr events
-    xcb_void_cookie_t c = xcb_randr_select_input_checked(
-        con, root,
-        (uint16_t)(
-            XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE |
-            XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE |
-            XCB_RANDR_NOTIFY_MASK_OUTPUT_CHANGE));
     if ((err = xcb_request_check(con, c))) {
         LERR("Failed to initialise RandR extension (%s); falling back to Xinerama.", xerrcode_str(err->error_code));
         free(err);
         return 0;
     }
-    xcb_flush(con);
 
     return randrbase;
 }
@@ -87,31 +86,66 @@ uint8_t randr_init(xcb_connection_t *const con, const xcb_window_t root, const u
 void randr_event_handle(session_t *const session, xcb_generic_event_t *const ev) {
     const uint8_t randrbase = session->randrbase;
 
-    const uint8_t t = randrbase + ev->response_type;
+    const uint8_t t = (ev->response_type & ~0x80) - randrbase;
 
-    // TODO: XCB_RANDR_NOTIFY_CRTC_CHANGE and XCB_RANDR_NOTIFY_OUTPUT_CHANGE - keep stored monitors up-to-date
     switch (t) {
+        case XCB_RANDR_SCREEN_CHANGE_NOTIFY:
+            break;
+        case XCB_RANDR_NOTIFY: {
+            // only changes to crtcs and outputs affect the monitor layout (not e.g. output property changes)
+            const uint8_t sub = ((const xcb_randr_notify_event_t *)ev)->subCode;
+            if (sub != XCB_RANDR_NOTIFY_CRTC_CHANGE && sub != XCB_RANDR_NOTIFY_OUTPUT_CHANGE) {
+                goto out_unhandled;
+            }
+            break;
+        }
         default:
             goto out_unhandled;
     }
 
+    // hotplugging produces a burst of these events, which is coalesced into one update of the monitor set
+    session_schedule_monitor_update(session);
+
 // out:
-    LLOG("randr_event_handle() handled %s", xevent_str(t));
+    LLOG("randr_event_handle() handled %s", xevent_str(ev->response_type & ~0x80));
 out_unhandled:
     return;
 }
 
-monitor_t **randr_query_monitors(xcb_connection_t *const con, const xcb_window_t root, uint32_t *const len) {
-    monitor_t **mons = NULL;
+monitor_t *randr_query_monitors(xcb_connection_t *const con, const xcb_window_t root, uint32_t *const len) {
+    monitor_t *mons = NULL;
     uint32_t monn = 0;
 
     xcb_randr_output_t *outputs;
     uint32_t outputn;
     xcb_timestamp_t tstamp;
 
+    // screen resources are needed for the mode list (refresh rates), the crtc list, and for the outputs themselves with RandR <= 1.4
+    // with RandR >= 1.5, the monitor list is requested at the same time
+    const xcb_randr_get_screen_resources_current_cookie_t rescookie = xcb_randr_get_screen_resources_current(con, root);
+    xcb_randr_get_monitors_cookie_t monscookie = { 0 };
+    if (has_randr_1_5) {
+        monscookie = xcb_randr_get_monitors(con, root, 1);
+    }
+
+    xcb_randr_get_screen_resources_current_reply_t *res = xcb_randr_get_screen_resources_current_reply(con, rescookie, NULL);
+    if (!res) {
+        LERR("Failed to get RandR screen resources");
+        if (has_randr_1_5) {
+            xcb_discard_reply(con, monscookie.sequence);
+        }
+        return NULL;
+    }
+
+    const xcb_randr_mode_info_t *const modes = xcb_randr_get_screen_resources_current_modes(res);
+    const uint32_t moden = xcb_randr_get_screen_resources_current_modes_length(res);
+
+    const xcb_randr_crtc_t *const crtcs = xcb_randr_get_screen_resources_current_crtcs(res);
+    const uint32_t crtcn = xcb_randr_get_screen_resources_current_crtcs_length(res);
+
     if (has_randr_1_5) {
         // find outputs with RandR >= 1.5
-        outputs = randr_find_outputs_1_5(con, root, &outputn, &tstamp);
+        outputs = randr_find_outputs_1_5(con, monscookie, &outputn, &tstamp);
         if (!outputs) {
             // 1.5 function failed, fallback to 1.4
             LWARN("RandR 1.5 query failed, falling back to 1.4.");
@@ -120,36 +154,82 @@ monitor_t **randr_query_monitors(xcb_connection_t *const con, const xcb_window_t
     } else {
 fallback_1_4:
         // find outputs with RandR <= 1.4
-        outputs = randr_find_outputs_1_4(con, root, &outputn, &tstamp);
+        outputs = randr_find_outputs_1_4(res, &outputn, &tstamp);
+    }
+    if (!outputs) {
+        free(res);
+        return NULL;
+    }
+
+    // scratch space for cookies and replies of every output and crtc (reply pointers come first so the cookies after them stay aligned, and one
+    // spare byte keeps calloc() from returning NULL when there is nothing to query)
+    void *const scratch = calloc(1,
+        outputn * (sizeof(xcb_randr_get_output_info_cookie_t) + sizeof(xcb_randr_get_output_info_reply_t *)) +
+        crtcn * (sizeof(xcb_randr_get_crtc_info_cookie_t) + sizeof(xcb_randr_get_crtc_info_reply_t *)) + 1);
+    // the result is allocated up front (at most one monitor per output)
+    mons = malloc(sizeof(monitor_t) * ((outputn) ? outputn : 1));
+    if (!scratch || !mons) {
+        LERR("malloc() fault when RandR-querying monitors");
+        free(scratch);
+        free(mons);
+        free(outputs);
+        free(res);
+        return NULL;
+    }
+
+    xcb_randr_get_output_info_reply_t **const outputinfos = (xcb_randr_get_output_info_reply_t **)scratch;
+    xcb_randr_get_crtc_info_reply_t **const crtcinfos = (xcb_randr_get_crtc_info_reply_t **)(outputinfos + outputn);
+    xcb_randr_get_output_info_cookie_t *const outputcookies = (xcb_randr_get_output_info_cookie_t *)(crtcinfos + crtcn);
+    xcb_randr_get_crtc_info_cookie_t *const crtccookies = (xcb_randr_get_crtc_info_cookie_t *)(outputcookies + outputn);
+
+    // output and crtc info are requested for everything at once (crtcs are taken from the screen resources, so they don't need to wait for the output
+    // info replies), so the whole query takes one round trip
+    for (uint32_t i = 0; i < outputn; i++) {
+        outputcookies[i] = xcb_randr_get_output_info(con, outputs[i], tstamp);
+    }
+    for (uint32_t i = 0; i < crtcn; i++) {
+        crtccookies[i] = xcb_randr_get_crtc_info(con, crtcs[i], tstamp);
+    }
+    for (uint32_t i = 0; i < outputn; i++) {
+        outputinfos[i] = xcb_randr_get_output_info_reply(con, outputcookies[i], NULL);
+    }
+    for (uint32_t i = 0; i < crtcn; i++) {
+        crtcinfos[i] = xcb_randr_get_crtc_info_reply(con, crtccookies[i], NULL);
     }
 
     for (uint32_t i = 0; i < outputn; i++) {
-        const xcb_randr_output_t o = outputs[i];
+        const xcb_randr_get_output_info_reply_t *const outputinfo = outputinfos[i];
 
-        if (!validate_output(con, o, tstamp)) {
+        // if no CRTC or if the output is disconnected then we have no use for it
+        if (!outputinfo || outputinfo->crtc == XCB_NONE || outputinfo->connection != XCB_RANDR_CONNECTION_CONNECTED) {
             continue;
         }
 
-        monitor_t m = monitor_init(con, o, tstamp);
-        monitor_t *mp = malloc(sizeof(monitor_t));
-        if (!mp) {
-            free(outputs);
-            LERR("malloc() fault");
-            return NULL;
+        const xcb_randr_get_crtc_info_reply_t *crtcinfo = NULL;
+        for (uint32_t j = 0; j < crtcn; j++) {
+            if (crtcs[j] == outputinfo->crtc) {
+                crtcinfo = crtcinfos[j];
+                break;
+            }
         }
-        memcpy(mp, &m, sizeof(monitor_t));
-
-        monn++;
-        mons = realloc(mons, sizeof(monitor_t *) * monn);
-        if (!mons) {
-            free(outputs);
-            LERR("realloc() fault when RandR-querying monitors");
-            return NULL;
+        if (!crtcinfo) {
+            LWARN("Could not get info of crtc 0x%08x for output 0x%08x", outputinfo->crtc, outputs[i]);
+            continue;
         }
-        mons[monn-1] = mp;
+
+        mons[monn++] = monitor_init(outputs[i], outputinfo, crtcinfo, modes, moden);
     }
 
+    for (uint32_t i = 0; i < outputn; i++) {
+        free(outputinfos[i]);
+    }
+    for (uint32_t i = 0; i < crtcn; i++) {
+        free(crtcinfos[i]);
+    }
+    free(scratch);
+
     free(outputs);
+    free(res);
 
     if (len) {
         *len = monn;
@@ -158,17 +238,11 @@ fallback_1_4:
     return mons;
 }
 
-static xcb_randr_output_t *randr_find_outputs_1_4(xcb_connection_t *const con, const xcb_window_t root, uint32_t *const len,
+static xcb_randr_output_t *randr_find_outputs_1_4(const xcb_randr_get_screen_resources_current_reply_t *const res, uint32_t *const len,
     xcb_timestamp_t *const tstamp) {
     xcb_randr_output_t *outputs;
     int32_t outputn;
 
-    xcb_randr_get_screen_resources_current_reply_t *res = xcb_randr_get_screen_resources_current_reply(con,
-        xcb_randr_get_screen_resources_current(con, root), NULL);
-    if (!res) {
-        return NULL;
-    }
-
     // to get consistent information from the server
     if (tstamp) {
         *tstamp = res->config_timestamp;
@@ -176,10 +250,12 @@ static xcb_randr_output_t *randr_find_outputs_1_4(xcb_connection_t *const con, c
 
     outputn = xcb_randr_get_screen_resources_current_outputs_length(res);
     outputs = malloc(sizeof(xcb_randr_output_t) * outputn);
+    if (!outputs) {
+        LERR("malloc() fault");
+        return NULL;
+    }
     memcpy(outputs, xcb_randr_get_screen_resources_current_outputs(res), sizeof(xcb_randr_output_t) * outputn);
 
-    free(res);
-
     if (len) {
         *len = outputn;
     }
@@ -187,16 +263,16 @@ static xcb_randr_output_t *randr_find_outputs_1_4(xcb_connection_t *const con, c
     return outputs;
 }
 
-static xcb_randr_output_t *randr_find_outputs_1_5(xcb_connection_t *const con, const xcb_window_t root, uint32_t *const len,
-    xcb_timestamp_t *const tstamp) {
+static xcb_randr_output_t *randr_find_outputs_1_5(xcb_connection_t *const con, const xcb_randr_get_monitors_cookie_t cookie,
+    uint32_t *const len, xcb_timestamp_t *const tstamp) {
     xcb_generic_error_t *err;
     xcb_randr_output_t *outputs = NULL;
     int32_t outputn = 0;
 
-    xcb_randr_get_monitors_reply_t *mons = xcb_randr_get_monitors_reply(con, xcb_randr_get_monitors(con, root, 1), &err);
+    xcb_randr_get_monitors_reply_t *mons = xcb_randr_get_monitors_reply(con, cookie, &err);
     if (err) {
-        free(err);
         LERR("Failed to get RandR monitors: %s", xerrcode_str(err->error_code));
+        free(err);
         return NULL;
     }
 
@@ -249,32 +325,3 @@ static xcb_randr_output_t *randr_find_outputs_1_5(xcb_connection_t *const con, c
 
     return outputs;
 }
-
-static uint8_t validate_output(xcb_connection_t *const con, const xcb_randr_output_t output, const xcb_timestamp_t tstamp) {
-    uint8_t ret = 1;
-
-    xcb_randr_get_output_info_reply_t *info;
-
-    xcb_randr_crtc_t crtc;
-    uint8_t connection;
-
-    // get output info
-    info = xcb_randr_get_output_info_reply(con,
-        xcb_randr_get_output_info(con, output, tstamp), NULL);
-    if (!info) {
-        goto out2;
-    }
-    crtc = info->crtc;
-    connection = info->connection;
-
-    // if no CRTC or if the output is disconnected then we have no use for it
-    if (crtc == XCB_NONE || connection != XCB_RANDR_CONNECTION_CONNECTED) {
-        ret = 0;
-        goto out1;
-    }
-
-out1:
-    free(info);
-out2:
-    return ret;
-}
@@ -37,10 +37,10 @@ void randr_event_handle(
 );
 
 /**
- * Return heap-allocated array of ptrs to heap-allocated awm monitor structs, created by data queried from XRandR. The amount of monitors is returned
- * into `len`. Finally, NULL is returned if there was an error.
+ * Return heap-allocated array of awm monitor structs, created by data queried from XRandR. The amount of monitors is returned into `len`. Finally, NULL
+ * is returned if there was an error.
  */
-monitor_t **randr_query_monitors(
+monitor_t *randr_query_monitors(
     xcb_connection_t *const con,
     const xcb_window_t root,
     uint32_t *const len
@@ -31,9 +31,8 @@ void xinerama_init(xcb_connection_t *const con) {
     free(actr);
 }
 
-monitor_t **xinerama_query_monitors(xcb_connection_t *const con, uint32_t *const len) {
-    monitor_t **mons = NULL;
-    uint32_t monn = 0;
+monitor_t *xinerama_query_monitors(xcb_connection_t *const con, uint32_t *const len) {
+    monitor_t *mons;
 
     xcb_xinerama_screen_info_t *scrs;
     uint32_t scrn;
@@ -46,33 +45,21 @@ monitor_t **xinerama_query_monitors(xcb_connection_t *const con, uint32_t *const
     scrn = xcb_xinerama_query_screens_screen_info_length(scrrep);
     scrs = xcb_xinerama_query_screens_screen_info(scrrep);
 
-    for (uint32_t i = 0; i < scrn; i++) {
-        const xcb_xinerama_screen_info_t s = scrs[i];
-
-        monitor_t m = monitor_init_xinerama(&s);
-        monitor_t *mp = malloc(sizeof(monitor_t));
-        if (!mp) {
-            free(scrrep);
-            LERR("malloc() fault");
-            return NULL;
-        }
-        memcpy(mp, &m, sizeof(monitor_t));
+    mons = malloc(sizeof(monitor_t) * ((scrn) ? scrn : 1));
+    if (!mons) {
+        free(scrrep);
+        LERR("malloc() fault when Xinerama-querying monitors");
+        return NULL;
+    }
 
-        monn++;
-        mons = realloc(mons, sizeof(monitor_t *) * monn);
-        if (!mons) {
-            free(scrrep);
-            free(mp);
-            LERR("realloc() fault when Xinerama-querying monitors");
-            return NULL;
-        }
-        mons[monn-1] = mp;
+    for (uint32_t i = 0; i < scrn; i++) {
+        mons[i] = monitor_init_xinerama(&scrs[i]);
     }
 
     free(scrrep);
 
     if (len) {
-        *len = monn;
+        *len = scrn;
     }
 
     return mons;
@@ -34,10 +34,10 @@ xcb_xinerama_screen_info_t *xinerama_find_screens(
 );
 
 /**
- * Return heap-allocated array of ptrs to heap-allocated awm monitor structs, created by data queried from Xinerama. The amount of monitors is
- * returned into `len`. Finally, NULL is returned if there was an error.
+ * Return heap-allocated array of awm monitor structs, created by data queried from Xinerama. The amount of monitors is returned into `len`. Finally,
+ * NULL is returned if there was an error.
  */
-monitor_t **xinerama_query_monitors(
+monitor_t *xinerama_query_monitors(
     xcb_connection_t *const con,
     uint32_t *const len
 );
@@ -10,24 +10,66 @@
 #include "init/config.h"
 #include "manager/atoms.h"
 #include "manager/client/client.h"
+#include "init/sighandle.h"
+#include "manager/evbatch.h"
 #include "manager/multihead/monitor.h"
 #include "manager/multihead/randr.h"
 #include "manager/multihead/xinerama.h"
 #include "manager/events.h"
+#include "util/genutil.h"
 #include "util/logging.h"
-#include "util/xstr.h"
 
+#include <inttypes.h>
 #include <string.h>
+#include <unistd.h>
+#include <xcb/sync.h>
 
 /**
- * Register events from a session's root window in order to intercept requests from top level windows.
+ * Time to wait after the last RandR event of a burst before the monitor set is updated, in nanoseconds.
+ */
+#define MONITOR_UPDATE_DEBOUNCE_NS (150 * 1000000ULL)
+
+/**
+ * Glyphs of the standard cursor font shown over each kind of resize grip, in the order of the grip roles.
+ */
+static const uint16_t grip_cursor_glyphs[CLIENT_GRIP_COUNT] = {
+    70,     // XC_left_side
+    96,     // XC_right_side
+    138,    // XC_top_side
+    16,     // XC_bottom_side
+    134,    // XC_top_left_corner
+    136,    // XC_top_right_corner
+    12,     // XC_bottom_left_corner
+    14,     // XC_bottom_right_corner
+};
+
+/**
+ * Register events from a session's root window in order to intercept requests from top level windows. The request is not checked here; pass the
+ * returned cookie to `check_wm_substructure_events()`.
+ */
+static xcb_void_cookie_t register_wm_substructure_events(
+    xcb_connection_t *const con,
+    const xcb_window_t root
+);
+
+/**
+ * Check that registering root window events with `register_wm_substructure_events()` succeeded.
  *
  * As only one X client can listen to substructure redirection on the root window at a time, we consider another
  * concurrent WM to be an error.
  */
-static void register_wm_substructure_events(
+static void check_wm_substructure_events(
     xcb_connection_t *const con,
-    const xcb_window_t root
+    const xcb_void_cookie_t cookie
+);
+
+/**
+ * If startup profiling is enabled, log the wall-clock time taken by startup phase `phase` (i.e. since `*t`), then reset `*t` to now.
+ */
+static void profile_phase(
+    const session_t *const session,
+    const char *const phase,
+    uint64_t *const t
 );
 
 /**
@@ -37,18 +79,115 @@ static void manage_existing_clients(
     session_t *const session
 );
 
+/**
+ * Initialise the XSync extension, used to pace interactive resizes with clients supporting _NET_WM_SYNC_REQUEST. Returns the extension's base event,
+ * or 0 if it is not available.
+ */
+static uint8_t sync_init(
+    xcb_connection_t *const con
+);
+
+/**
+ * Create the cursors shown over resize grips from the standard cursor font into `cursors`. Cursors that couldn't be created are left as XCB_NONE,
+ * in which case the parent window's cursor is shown instead.
+ */
+static void grip_cursors_init(
+    xcb_connection_t *const con,
+    xcb_cursor_t *const cursors
+);
+
+/**
+ * Returns 1 if monitor sets `a` and `b` contain the same monitors, with the same dimensions and refresh rates.
+ */
+static uint8_t monitorsets_equal(
+    const monitorset_t *const a,
+    const monitorset_t *const b
+);
+
+/**
+ * Find where `client` should be moved to after the monitor layout changed from `oldset` to the session's current monitor set. Returns 0 if the
+ * client doesn't need to move; otherwise its new (inner) position is returned into `pos`.
+ */
+static uint8_t migration_target(
+    session_t *const session,
+    const client_t *const client,
+    const monitorset_t *const oldset,
+    offset_t *const pos
+);
+
+/**
+ * Handle `ev` (if not NULL) along with every event already queued by xcb, in batches. Nothing is read from the X connection.
+ */
+static void handle_events(
+    session_t *const session,
+    xcb_generic_event_t *ev
+);
+
+/**
+ * Event loop callback: the X connection is readable.
+ */
+static void xsource_cb(
+    evloop_source_t *const src,
+    void *const data
+);
+
+/**
+ * Event loop callback: the monitor update debounce timer expired.
+ */
+static void monitortimer_cb(
+    evloop_source_t *const src,
+    void *const data
+);
+
+/**
+ * Event loop callback: a termination signal is pending.
+ */
+static void sigsource_cb(
+    evloop_source_t *const src,
+    void *const data
+);
+
 session_t session_init(xcb_connection_t *const con, const int32_t scrnum, const session_config_t *const cfg) {
     session_t session;
 
     xcb_screen_t *scr = NULL;
     xcb_window_t root;
 
+    uint64_t tphase = monotime_ns();
+
     // copy config into session struct
     session.cfg = *cfg;
 
     // store connection handle
     session.con = con;
 
+    session.errtable = errtable_init();
+
+    session.evstats = (session_evstats_t){ 0 };
+    session.outdirty = 0;
+
+    // the debounce timer is created once the session is running
+    session.monitortimer.fd = -1;
+    session.monitorevents = 0;
+
+    // as are drag timers
+    memset(&session.drag, 0, sizeof(drag_t));
+    session.drag.pacer.timer.fd = -1;
+    session.drag.syncer.timer.fd = -1;
+
+    // the frame pool is filled once the session is idle
+    memset(&session.framepool, 0, sizeof(clientframepool_t));
+
+    // create event loop (sources are registered once the session is running, as they point back to it)
+    session.loop = evloop_init();
+    if (session.loop.epfd < 0) {
+        LFATAL("Failed to create event loop");
+        KILL();
+    }
+    session.xsource.fd = -1;
+    session.sigsource.fd = -1;
+    session.termsig = 0;
+
     // use screen indexed at scrnum
     xcb_screen_iterator_t iter = xcb_setup_roots_iterator(xcb_get_setup(con));
     for (uint32_t i = scrnum; iter.rem; i--, xcb_screen_next(&iter)) {
@@ -66,8 +205,26 @@ session_t session_init(xcb_connection_t *const con, const int32_t scrnum, const
     root = scr->root;
     session.root = root;
 
+    profile_phase(&session, "session setup", &tphase);
+
+    // every independent startup request is sent up front (atoms, extension queries, root registration), then the replies are collected, so
+    // startup costs one round trip rather than one per request
+    const atoms_cookies_t atomcookies = atoms_request_owned(con);
+
+    // prefetch X extensions (xinerama is also prefetched as a fallback when randr is preferred)
+    xcb_prefetch_extension_data(con, &xcb_xinerama_id);
+    if (!session.cfg.force_xinerama) {
+        xcb_prefetch_extension_data(con, &xcb_randr_id);
+    }
+    xcb_prefetch_extension_data(con, &xcb_sync_id);
+
+    // listen to root events
+    const xcb_void_cookie_t rootcookie = register_wm_substructure_events(con, root);
+
+    xcb_flush(con);
+
     // set up necessary atoms
-    const char *noatom = atoms_init_owned(con);
+    const char *noatom = atoms_collect_owned(con, &atomcookies);
     if (noatom) {
         LFATAL("Failed to initialise atom \"%s\"", noatom);
         KILL();
@@ -75,15 +232,9 @@ session_t session_init(xcb_connection_t *const con, const int32_t scrnum, const
 
     event_propertynotify_handlers_init();
 
-    // prefetch X extensions
-    if (session.cfg.force_xinerama) {
-        xcb_prefetch_extension_data(con, &xcb_xinerama_id);
-    } else {
-        xcb_prefetch_extension_data(con, &xcb_randr_id);
-    }
+    check_wm_substructure_events(con, rootcookie);
 
-    // listen to root events
-    register_wm_substructure_events(con, root);
+    profile_phase(&session, "atoms and root registration", &tphase);
 
     // init randr (or xinerama, fallback) and find monitors
     session.randrbase = 0;
@@ -91,106 +242,238 @@ session_t session_init(xcb_connection_t *const con, const int32_t scrnum, const
         xinerama_init(con);
     }
 
+    profile_phase(&session, "multihead extension init", &tphase);
+
+    session.syncbase = sync_init(con);
+
+    // (before any clients are framed, as their resize grips are created with these cursors)
+    grip_cursors_init(con, session.gripcursors);
+
+    // initialise client set and stacking order (before monitors, as updating monitors visits clients)
+    session.clientset = clientset_init();
+    session.stack = stack_init(con, scr);
+    session.focused = CLIENT_HANDLE_NONE;
+    session.lasttime = XCB_CURRENT_TIME;
+
     session.monitorset = monitorset_init();
+    session.spatial = spatial_init();
     session_update_monitorset(&session);
 
-    // initialise client set
-    session.clientset = clientset_init();
+    profile_phase(&session, "monitor discovery", &tphase);
+
+    // clear any active window left over from a previous window manager
+    xcb_change_property(con, XCB_PROP_MODE_REPLACE, session.root, ATOMS__NET_ACTIVE_WINDOW, XCB_ATOM_WINDOW, 32, 1, (xcb_window_t []) { XCB_NONE });
 
     // manage windows/clients that were created before wm start
     // we grab the server while doing this so the state doesn't change halfway through
+    const uint64_t grabstart = monotime_ns();
     xcb_grab_server(con);
     {
         manage_existing_clients(&session);
     }
     xcb_ungrab_server(con);
+    xcb_flush(con);
+    LINFO("Adopted existing windows with the server grabbed for %" PRIu64 " us", (monotime_ns() - grabstart) / 1000);
+
+    profile_phase(&session, "adopting existing windows", &tphase);
 
     return session;
 }
 
 void session_dealloc(session_t *const session) {
+    const session_evstats_t stats = session->evstats;
+    LLOG("Dispatched %" PRIu64 " events in %" PRIu64 " batches (%" PRIu64 " merged)", stats.recieved - stats.merged, stats.batches, stats.merged);
+    LLOG("Flushed X output %" PRIu64 " times (%" PRIu64 " flushes deferred)", stats.flushes, stats.deferred);
+    LLOG("Skipped %" PRIu64 " redundant focus changes and %" PRIu64 " redundant restacks", stats.focus_skipped, stats.restack_skipped);
+    LLOG("Framed %" PRIu64 " clients with pooled frames", stats.frames_reused);
+
+    // (before clients are freed, as a drag in progress refers to one)
+    drag_dealloc(session);
+
     clientset_t clientset = session->clientset;
     monitorset_t monitorset = session->monitorset;
 
     clientset_dealloc(&clientset);
     monitorset_dealloc(&monitorset);
 
+    client_framepool_dealloc(session);
+
+    for (uint32_t i = 0; i < CLIENT_GRIP_COUNT; i++) {
+        if (session->gripcursors[i] != XCB_NONE) {
+            xcb_free_cursor(session->con, session->gripcursors[i]);
+        }
+    }
+
+    stack_dealloc(&session->stack);
+    spatial_dealloc(&session->spatial);
+    errtable_dealloc(&session->errtable);
+
+    evloop_timer_dealloc(&session->loop, &session->monitortimer);
+    evloop_dealloc(&session->loop);
+    if (session->sigsource.fd >= 0) {
+        close(session->sigsource.fd);
+    }
+
     memset(session, 0, sizeof(session_t));
 }
 
-client_t *session_manage_client(session_t *const session, xcb_window_t win) {
+client_t *session_manage_client(session_t *const session, xcb_window_t win, const clientprops_t *const props) {
     xcb_connection_t *const con = session->con;
-    xcb_screen_t *const scr = session->scr;
 
-    clientset_t clientset = session->clientset;
+    clientset_t *const clientset = &session->clientset;
 
-    xcb_generic_error_t *err;
+    clientprops_t initprops;
+
+    if (props) {
+        initprops = *props;
+    } else if (!clientprops_init_all(session, win, &initprops)) {
+        LERR("Failed to get properties of window 0x%08x", win);
+        return NULL;
+    }
 
     // TODO: consider windows that shouldn't be framed like this (dropdowns, fullscreen, etc)
     //       i.e. get window X properties (ICCCM + EWMH)
-    // create a framed client for the window
-    client_t *const client = malloc(sizeof(client_t));
+    // create a framed client for the window (clients are allocated from the client set's slab)
+    client_t *const client = clientset_alloc_client(clientset);
     if (!client) {
-        LERR("malloc() fault");
+        LERR("Failed to allocate client for window 0x%08x", win);
+        clientprops_dealloc(&initprops);
         return NULL;
     }
-    *client = client_init_framed(con, scr, win);
+    *client = client_init_framed(session, win, initprops);
 
     // if there was an error framing the client
     if (client->frame == (xcb_window_t)-1) {
+        clientset_free_client(clientset, client);
         return NULL;
     }
 
     // manage new client
-    if (!clientset_push(&clientset, client)) {
+    if (!clientset_push(clientset, client)) {
         // if we can't keep track of the client then issues will arise later, so best to just avoid trying to manage the window
-        free(client);
+        clientset_free_client(clientset, client);
 
         return NULL;
     }
 
-    // add window to save set - will be remapped if the window manager is killed
-    if ((err = xcb_request_check(con, xcb_change_save_set_checked(con, XCB_SET_MODE_INSERT, win)))) {
-        LERR("When adding window 0x%08x to save-set: error %u (%s)", win, err->error_code, xerrcode_str(err->error_code));
+    // new clients go on top of the normal layer
+    stack_push(session, client, STACK_LAYER_NORMAL);
+    clientprops_index(session, client);
+    clientprops_update_monitor(session, client);
 
-        free(err);
-    }
+    // add window to save set - will be remapped if the window manager is killed
+    errtable_track(&session->errtable, xcb_change_save_set(con, XCB_SET_MODE_INSERT, win), win, "adding window to save-set", NULL);
+    session_defer_flush(session);
 
     LLOG("Session managed X window 0x%08x", win);
 
     return client;
 }
 
-void session_handle_next_event(session_t *const session) {
-    xcb_connection_t *const con = session->con;
-    const uint8_t randrbase = session->randrbase;
+void session_unmanage_client(session_t *const session, client_t *const client) {
+    clientset_t *const clientset = &session->clientset;
 
-    xcb_flush(con);
+    const xcb_window_t inner = client->inner;
+
+    if (clientset_get(clientset, session->focused) == client) {
+        client_set_focused(session, NULL);
+    }
+    drag_forget_client(session, client);
 
-    if (xcb_connection_has_error(con)) {
-        LFATAL("The X connection was unexpectedly interrupted (did the X server terminate/crash?)");
+    // remove all references to the client (while its windows are still known)
+    clientset_remove(clientset, client);
+    stack_remove(session, client);
+    spatial_remove(&session->spatial, client->spatialid);
+    client->spatialid = SPATIAL_ID_NONE;
+
+    // destroy frame (note this does not destroy the inner window, which instead is reparented to root)
+    client_frame_destroy(session, client, session->root);
+
+    // return the client to the slab (any handles to it that are still held are now stale)
+    clientset_free_client(clientset, client);
+
+    LLOG("Session unmanaged X window 0x%08x", inner);
+}
+
+int session_run(session_t *const session, const int sigfd) {
+    xcb_connection_t *const con = session->con;
+    evloop_t *const loop = &session->loop;
+
+    session->xsource = (evloop_source_t){
+        .fd = xcb_get_file_descriptor(con),
+        .cb = xsource_cb,
+        .data = session,
+        .is_timer = 0
+    };
+    session->sigsource = (evloop_source_t){
+        .fd = sigfd,
+        .cb = sigsource_cb,
+        .data = session,
+        .is_timer = 0
+    };
+
+    if (!evloop_add(loop, &session->xsource) || !evloop_add(loop, &session->sigsource)) {
+        LFATAL("Failed to start event loop");
         KILL();
     }
 
-    xcb_generic_event_t *ev = xcb_wait_for_event(con);
-    if (!ev) {
-        return;
+    // monitor changes are only reported by RandR
+    if (session->randrbase && !evloop_timer_init(loop, &session->monitortimer, monitortimer_cb, session)) {
+        LWARN("Failed to create monitor update timer; monitor changes will not be debounced");
+    }
+    if (!drag_init(session)) {
+        LWARN("Failed to create drag timers; drags will not be paced or synchronised with clients");
     }
 
-    // handle the next event
-    event_handle(session, ev);
-    if (randrbase) {
-        randr_event_handle(session, ev);
+    loop->running = 1;
+    while (loop->running) {
+        // xcb may already have read events off the connection (e.g. while waiting for a reply), in which case the fd won't become readable
+        handle_events(session, xcb_poll_for_queued_event(con));
+
+        // the reply to a drag's pointer grab may have been read along with events
+        drag_check_grab(session);
+
+        // every queued event has been handled, so the session is idle until the loop wakes up again
+        client_framepool_refill(session);
+
+        // requests made while handling events are sent before blocking again
+        session_flush(session);
+
+        if (xcb_connection_has_error(con)) {
+            LFATAL("The X connection was unexpectedly interrupted (did the X server terminate/crash?)");
+            KILL();
+        }
+
+        evloop_wait(loop, -1);
     }
 
-    free(ev);
+    return session->termsig;
+}
+
+void session_defer_flush(session_t *const session) {
+    session->outdirty = 1;
+    session->evstats.deferred++;
+}
+
+void session_flush(session_t *const session) {
+    // stacking order changes are published once per flush rather than once per change
+    stack_publish(session);
+
+    if (!session->outdirty) {
+        return;
+    }
+
+    xcb_flush(session->con);
+
+    session->outdirty = 0;
+    session->evstats.flushes++;
 }
 
 void session_update_monitorset(session_t *const session) {
     xcb_connection_t *const con = session->con;
     const xcb_window_t root = session->root;
 
-    monitor_t **monitors;
+    monitor_t *monitors;
     uint32_t monitorn;
 
     if (session->randrbase) {
@@ -204,25 +487,87 @@ void session_update_monitorset(session_t *const session) {
         return;
     }
 
+    monitorset_t newset = monitorset_init();
     for (uint32_t i = 0; i < monitorn; i++) {
-        monitorset_push(&session->monitorset, monitors[i]);
+        monitorset_push(&newset, &monitors[i]);
     }
-
     free(monitors);
 
-    LINFO("Updated monitor set includes %u monitors", monitorn);
+    if (monitorsets_equal(&session->monitorset, &newset)) {
+        LLOG("Monitor layout unchanged");
+        monitorset_dealloc(&newset);
+        return;
+    }
+
+    // the old set is kept until clients have been moved off of it
+    monitorset_t oldset = session->monitorset;
+    session->monitorset = newset;
+
+    // monitors are indexed afresh (pointers into the old set are no longer valid)
+    spatial_clear(&session->spatial, SPATIAL_KIND_MONITOR);
+    for (uint32_t i = 0; i < newset.len; i++) {
+        spatial_insert(&session->spatial, SPATIAL_KIND_MONITOR, &newset.monitors[i], newset.monitors[i].dims);
+    }
+
+    // find out if any clients were on monitors that were removed or changed
+    uint32_t moven = 0;
+    offset_t pos;
+    for (uint32_t l = 0; l < STACK_LAYER_COUNT; l++) {
+        for (client_t *c = session->stack.bottom[l]; c; c = c->stack.above) {
+            moven += migration_target(session, c, &oldset, &pos);
+        }
+    }
+
+    // if so, move them all in one go, with the server grabbed so the new layout is applied atomically
+    if (moven) {
+        xcb_grab_server(con);
+        for (uint32_t l = 0; l < STACK_LAYER_COUNT; l++) {
+            for (client_t *c = session->stack.bottom[l]; c; c = c->stack.above) {
+                if (migration_target(session, c, &oldset, &pos)) {
+                    clientprops_set_pos(session, c, pos);
+                }
+            }
+        }
+        xcb_ungrab_server(con);
+        session_defer_flush(session);
+    }
+
+    // monitor indices cached on clients are no longer valid
+    for (uint32_t l = 0; l < STACK_LAYER_COUNT; l++) {
+        for (client_t *c = session->stack.bottom[l]; c; c = c->stack.above) {
+            clientprops_update_monitor(session, c);
+        }
+    }
+
+    monitorset_dealloc(&oldset);
+
+    LINFO("Updated monitor set includes %u monitors (%u clients moved)", newset.len, moven);
 }
 
-static void register_wm_substructure_events(xcb_connection_t *const con, const xcb_window_t root) {
-    xcb_generic_error_t *err;
+void session_schedule_monitor_update(session_t *const session) {
+    session->monitorevents++;
 
+    if (session->monitortimer.fd < 0) {
+        session_update_monitorset(session);
+        session->monitorevents = 0;
+        return;
+    }
+
+    // (re)start the timer, so the update happens once events stop arriving
+    evloop_timer_arm(&session->monitortimer, MONITOR_UPDATE_DEBOUNCE_NS, 0);
+}
+
+static xcb_void_cookie_t register_wm_substructure_events(xcb_connection_t *const con, const xcb_window_t root) {
     // register root window to intercept all top-level events
-    xcb_void_cookie_t c = xcb_change_window_attributes_checked(con, root, XCB_CW_EVENT_MASK,
-        (uint32_t[]) { XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT });
+    // (property changes are selected too, as changes the window manager makes to root properties are a source of server timestamps)
+    return xcb_change_window_attributes_checked(con, root, XCB_CW_EVENT_MASK,
+        (uint32_t[]) { XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_PROPERTY_CHANGE });
+}
 
-    xcb_flush(con);
+static void check_wm_substructure_events(xcb_connection_t *const con, const xcb_void_cookie_t cookie) {
+    xcb_generic_error_t *err;
 
-    if ((err = xcb_request_check(con, c))) {
+    if ((err = xcb_request_check(con, cookie))) {
         LFATAL("Another window manager is already running!");
 
         free(err);
@@ -230,6 +575,16 @@ static void register_wm_substructure_events(xcb_connection_t *const con, const x
     }
 }
 
+static void profile_phase(const session_t *const session, const char *const phase, uint64_t *const t) {
+    const uint64_t now = monotime_ns();
+
+    if (session->cfg.profile_startup) {
+        LINFO("Startup profile: %-28s %8" PRIu64 " us", phase, (now - *t) / 1000);
+    }
+
+    *t = now;
+}
+
 static void manage_existing_clients(session_t *const session) {
     xcb_connection_t *const con = session->con;
     const xcb_window_t root = session->root;
@@ -237,6 +592,10 @@ static void manage_existing_clients(session_t *const session) {
     // get window tree
     xcb_query_tree_reply_t *tree = xcb_query_tree_reply(con,
         xcb_query_tree(con, root), NULL);
+    if (!tree) {
+        LERR("Failed to query existing X windows");
+        return;
+    }
 
     // get child windows of the root
     int chldlen = xcb_query_tree_children_length(tree);
@@ -246,15 +605,230 @@ static void manage_existing_clients(session_t *const session) {
     }
     LLOG("Found %d existing X windows", chldlen);
 
-    // manage each existing window
     xcb_window_t *chld = xcb_query_tree_children(tree);
+
+    xcb_get_window_attributes_cookie_t *const acookies = malloc(sizeof(xcb_get_window_attributes_cookie_t) * chldlen);
+    clientprops_cookies_t *const pcookies = malloc(sizeof(clientprops_cookies_t) * chldlen);
+    if (!acookies || !pcookies) {
+        LERR("malloc() fault");
+        free(acookies);
+        free(pcookies);
+        goto cleanup;
+    }
+
+    // phase one: send every request needed to adopt each window, without waiting for any replies
+    for (int i = 0; i < chldlen; i++) {
+        acookies[i] = xcb_get_window_attributes(con, chld[i]);
+        pcookies[i] = clientprops_request_all(session, chld[i]);
+    }
+
+    // phase two: collect replies and manage each existing window that should be
     for (int i = 0; i < chldlen; i++) {
-        if (!session_manage_client(session, chld[i])) {
-            LERR("Could not manage existing window 0x%08x", chld[i]);
+        const xcb_window_t win = chld[i];
+
+        xcb_get_window_attributes_reply_t *const attr = xcb_get_window_attributes_reply(con, acookies[i], NULL);
+
+        // skip windows that no longer exist, manage themselves (e.g. menus), or aren't mapped (the client will send a MapRequest when it wants
+        // them to be shown)
+        if (!attr || attr->override_redirect || attr->map_state != XCB_MAP_STATE_VIEWABLE) {
+            clientprops_discard_all(session, &pcookies[i]);
+            free(attr);
+            continue;
+        }
+        free(attr);
+
+        clientprops_t props;
+        if (!clientprops_collect_all(session, win, &pcookies[i], &props) || !session_manage_client(session, win, &props)) {
+            LERR("Could not manage existing window 0x%08x", win);
             continue;
         }
     }
 
+    free(acookies);
+    free(pcookies);
+
 cleanup:
     free(tree);
 }
+
+static uint8_t sync_init(xcb_connection_t *const con) {
+    const xcb_query_extension_reply_t *const sync = xcb_get_extension_data(con, &xcb_sync_id);
+    if (!sync || !sync->present) {
+        LWARN("XSync is not present; resizes will not be synchronised with clients");
+        return 0;
+    }
+
+    // the protocol requires the version to be negotiated before any other request, but the reply itself isn't needed
+    xcb_discard_reply(con, xcb_sync_initialize(con, XCB_SYNC_MAJOR_VERSION, XCB_SYNC_MINOR_VERSION).sequence);
+
+    return sync->first_event;
+}
+
+static void grip_cursors_init(xcb_connection_t *const con, xcb_cursor_t *const cursors) {
+    static const char fontname[] = "cursor";
+
+    const xcb_font_t font = xcb_generate_id(con);
+    if (font == (xcb_font_t)-1) {
+        LWARN("Failed to allocate cursor font ID; resize grips will have no cursors");
+        memset(cursors, 0, sizeof(xcb_cursor_t) * CLIENT_GRIP_COUNT);
+        return;
+    }
+    xcb_open_font(con, font, sizeof(fontname) - 1, fontname);
+
+    for (uint32_t i = 0; i < CLIENT_GRIP_COUNT; i++) {
+        cursors[i] = xcb_generate_id(con);
+        if (cursors[i] == (xcb_cursor_t)-1) {
+            cursors[i] = XCB_NONE;
+            continue;
+        }
+
+        // each glyph in the cursor font is followed by its mask, and cursors are drawn black on white
+        xcb_create_glyph_cursor(con, cursors[i], font, font, grip_cursor_glyphs[i], grip_cursor_glyphs[i] + 1,
+            0, 0, 0, 0xffff, 0xffff, 0xffff);
+    }
+
+    // the cursors keep their glyphs after the font is closed
+    xcb_close_font(con, font);
+}
+
+static uint8_t monitorsets_equal(const monitorset_t *const a, const monitorset_t *const b) {
+    if (a->len != b->len) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < a->len; i++) {
+        const monitor_t *const ma = &a->monitors[i];
+        const monitor_t *const mb = monitorset_get(b, monitorset_index_of(b, ma));
+
+        if (!mb || memcmp(&ma->dims, &mb->dims, sizeof(rect_t)) != 0 || ma->refresh != mb->refresh) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static uint8_t migration_target(session_t *const session, const client_t *const client, const monitorset_t *const oldset, offset_t *const pos) {
+    const monitorset_t *const monitorset = &session->monitorset;
+
+    const margin_t margin = client->properties.innermargin;
+    const rect_t frame = clientprops_frame_rect(&client->properties);
+
+    // clients that weren't on a known monitor are left where they are
+    const monitor_t *const from = monitorset_get(oldset, client->monitor);
+    if (!from) {
+        return 0;
+    }
+
+    const monitor_t *to = monitorset_get(monitorset, monitorset_index_of(monitorset, from));
+    if (to && memcmp(&to->dims, &from->dims, sizeof(rect_t)) == 0) {
+        // monitor unchanged
+        return 0;
+    }
+
+    if (!to) {
+        // the monitor was removed - if the client is still visible on another monitor (e.g. one that was mirrored) then it can stay there
+        const offset_t centre = {
+            frame.offset.x + (int32_t)(frame.extent.width / 2),
+            frame.offset.y + (int32_t)(frame.extent.height / 2)
+        };
+        if (monitorset_index_at(monitorset, centre) != MONITORSET_INDEX_NONE) {
+            return 0;
+        }
+
+        to = monitorset_find_by_point(monitorset, centre);
+        if (!to) {
+            return 0;
+        }
+    }
+
+    // keep the client at the same position relative to the top-left of its monitor, but within the new monitor where it fits
+    const rect_t d = to->dims;
+    int64_t fx = (int64_t)d.offset.x + (frame.offset.x - from->dims.offset.x),
+            fy = (int64_t)d.offset.y + (frame.offset.y - from->dims.offset.y);
+
+    if (fx + frame.extent.width > (int64_t)d.offset.x + d.extent.width) fx = (int64_t)d.offset.x + d.extent.width - frame.extent.width;
+    if (fy + frame.extent.height > (int64_t)d.offset.y + d.extent.height) fy = (int64_t)d.offset.y + d.extent.height - frame.extent.height;
+    if (fx < d.offset.x) fx = d.offset.x;
+    if (fy < d.offset.y) fy = d.offset.y;
+
+    *pos = (offset_t){ (int32_t)fx + (int32_t)margin.left, (int32_t)fy + (int32_t)margin.top };
+
+    return pos->x != client->properties.rect.offset.x || pos->y != client->properties.rect.offset.y;
+}
+
+static void handle_events(session_t *const session, xcb_generic_event_t *ev) {
+    xcb_connection_t *const con = session->con;
+    const uint8_t randrbase = session->randrbase;
+
+    session_evstats_t *const stats = &session->evstats;
+
+    evbatch_t batch;
+
+    while (ev) {
+        batch.len = 0;
+
+        // drain everything that is already queued (without reading from the connection again) into the batch
+        do {
+            stats->recieved++;
+            stats->merged += evbatch_push(&batch, ev);
+
+            if (evbatch_full(&batch)) {
+                break;
+            }
+        } while ((ev = xcb_poll_for_queued_event(con)));
+
+        // handle each remaining event in order
+        for (uint32_t i = 0; i < batch.len; i++) {
+            ev = batch.evs[i];
+
+            event_handle(session, ev);
+            if (randrbase) {
+                randr_event_handle(session, ev);
+            }
+
+            free(ev);
+        }
+
+        // one flush per batch
+        session_flush(session);
+
+        stats->batches++;
+
+        ev = xcb_poll_for_queued_event(con);
+    }
+}
+
+static void xsource_cb(evloop_source_t *const src, void *const data) {
+    session_t *const session = (session_t *)data;
+
+    // suppress unused parameter
+    (void)src;
+
+    // read whatever is available on the connection (connection errors are picked up by the main loop)
+    handle_events(session, xcb_poll_for_event(session->con));
+}
+
+static void monitortimer_cb(evloop_source_t *const src, void *const data) {
+    session_t *const session = (session_t *)data;
+
+    // suppress unused parameter
+    (void)src;
+
+    LLOG("Updating monitor set after %u RandR events", session->monitorevents);
+    session->monitorevents = 0;
+
+    session_update_monitorset(session);
+}
+
+static void sigsource_cb(evloop_source_t *const src, void *const data) {
+    session_t *const session = (session_t *)data;
+
+    const int sig = read_signal_fd(src->fd);
+    if (!sig) {
+        return;
+    }
+
+    session->termsig = sig;
+    session->loop.running = 0;
+}
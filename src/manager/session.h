@@ -13,13 +13,42 @@
 #endif
 
 #include "init/config.h"
+#include "manager/client/client.h"
+#include "manager/client/clientprops.h"
 #include "manager/client/clientset.h"
+#include "manager/drag.h"
+#include "manager/errtable.h"
+#include "manager/evloop.h"
 #include "manager/multihead/monitorset.h"
+#include "manager/spatial.h"
+#include "manager/stack.h"
 
 #include <xcb/xcb.h>
 
 typedef struct session_config_t session_config_t;
 
+/**
+ * Counters kept by the session's event dispatcher.
+ */
+typedef struct session_evstats_t {
+    /** Total amount of events recieved from the X server */
+    uint64_t recieved;
+    /** Amount of events merged into an earlier event of the same batch (and so never dispatched on their own) */
+    uint64_t merged;
+    /** Amount of event batches dispatched */
+    uint64_t batches;
+    /** Amount of times X output was flushed (i.e. write syscalls on the connection) */
+    uint64_t flushes;
+    /** Amount of flushes requested while handling events, which were deferred to the end of the dispatch batch */
+    uint64_t deferred;
+    /** Amount of focus changes skipped as the client was already focused */
+    uint64_t focus_skipped;
+    /** Amount of restacks skipped as the client was already at the top of its layer */
+    uint64_t restack_skipped;
+    /** Amount of clients framed with a frame taken from the frame pool */
+    uint64_t frames_reused;
+} session_evstats_t;
+
 /**
  * A struct representing the window manager session.
  */
@@ -36,11 +65,50 @@ typedef struct session_t {
 
     /** Set of client references. */
     clientset_t clientset;
+    /** Client stacking order */
+    clientstack_t stack;
+    /** Handle of the focused client (stale or `CLIENT_HANDLE_NONE` if no client is focused) */
+    clienthandle_t focused;
+    /** Server timestamp of the most recent event carrying one (or `XCB_CURRENT_TIME` before any such event is recieved) */
+    xcb_timestamp_t lasttime;
+    /** Client drag state */
+    drag_t drag;
+    /** Unused frames, kept for framing new clients */
+    clientframepool_t framepool;
+    /** Cursors shown over each kind of resize grip (in the order of the grip roles), or XCB_NONE */
+    xcb_cursor_t gripcursors[CLIENT_GRIP_COUNT];
 
     /** RandR base event */
     uint8_t randrbase;
     /** Set of monitor references */
     monitorset_t monitorset;
+    /** Timer debouncing monitor set updates after RandR events */
+    evloop_source_t monitortimer;
+    /** Amount of RandR events recieved since the monitor set was last updated */
+    uint32_t monitorevents;
+
+    /** XSync base event, or 0 if the extension is unavailable */
+    uint8_t syncbase;
+
+    /** Spatial index over client frames and monitors */
+    spatial_t spatial;
+
+    /** Context of unchecked requests, used to attribute X errors as they arrive */
+    errtable_t errtable;
+
+    /** Event dispatcher counters */
+    session_evstats_t evstats;
+    /** 1 if requests have been made that haven't been flushed to the X server yet */
+    uint8_t outdirty;
+
+    /** Main event loop */
+    evloop_t loop;
+    /** Event loop source for the X connection */
+    evloop_source_t xsource;
+    /** Event loop source for termination signals */
+    evloop_source_t sigsource;
+    /** Signal that stopped the event loop, or 0 if it is still running */
+    int termsig;
 } session_t;
 
 /**
@@ -63,26 +131,67 @@ void session_dealloc(
 
 /**
  * Manage the given X client `win` under session `session` - returns NULL if failed.
+ *
+ * If the window's properties have already been collected they can be given in `props`; if `props` is NULL, they are queried here.
  */
 client_t *session_manage_client(
     session_t *const session,
-    xcb_window_t win
+    xcb_window_t win,
+    const clientprops_t *const props
+);
+
+/**
+ * Stop managing `client`: its frame is destroyed (the inner window is reparented back to root), all references to it are removed from the session,
+ * and it is freed.
+ */
+void session_unmanage_client(
+    session_t *const session,
+    client_t *const client
+);
+
+/**
+ * Run the session's event loop until a termination signal is read from signalfd `sigfd`, and return that signal. The session must not be moved
+ * in memory while this is running.
+ *
+ * Events recieved from the X server are handled in batches: everything already queued is drained, superseded events are coalesced, and the rest are
+ * handled in order with one flush per batch.
+ */
+int session_run(
+    session_t *const session,
+    const int sigfd
 );
 
 /**
- * Poll the next event recieved from the X server and handle it appropriately.
+ * Mark the session's X output as dirty: requests have been made and should be sent to the server. Rather than flushing immediately, the flush is
+ * deferred to the end of the current dispatch batch (or to the next blocking wait), so one batch of events results in one write to the connection.
  */
-void session_handle_next_event(
+void session_defer_flush(
     session_t *const session
 );
 
 /**
- * Update the session's monitor table to current information
+ * Flush the session's X output now, if it was marked dirty since the last flush.
+ */
+void session_flush(
+    session_t *const session
+);
+
+/**
+ * Update the session's monitor table to current information. The new monitor list is compared to the old one by output: if anything changed,
+ * clients on monitors that were removed or changed are moved onto the new layout together.
  */
 void session_update_monitorset(
     session_t *const session
 );
 
+/**
+ * Schedule an update of the session's monitor table. Updates are debounced, so a burst of RandR events (e.g. when docking) results in a single
+ * update once the burst is over.
+ */
+void session_schedule_monitor_update(
+    session_t *const session
+);
+
 #ifdef __cplusplus
     }
 #endif
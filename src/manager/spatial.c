@@ -0,0 +1,739 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#include "spatial.h"
+
+#include "util/logging.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CELL_MASK (SPATIAL_GRID_DIM - 1)
+
+/**
+ * Reference to the near (left or top) or far (right or bottom) edge of entry `id` in an edge list.
+ */
+#define EDGE_REF(id, far) (((uint32_t)(id) << 1) | (far))
+
+/**
+ * Range of (unwrapped) cell coordinates covered by a rectangle, inclusive. Ranges never span more than `SPATIAL_GRID_DIM` cells on either axis.
+ */
+typedef struct cellspan_t {
+    int32_t x0, y0;
+    int32_t x1, y1;
+} cellspan_t;
+
+/**
+ * Get the cell coordinate of pixel coordinate `v`, rounding towards negative infinity.
+ */
+static int32_t cell_coord(
+    const int32_t v
+);
+
+/**
+ * Get the range of cells covered by `rect`.
+ */
+static cellspan_t cell_span(
+    const rect_t rect
+);
+
+/**
+ * Returns 1 if the cell with wrapped coordinates `wx`, `wy` is covered by `span`.
+ */
+static uint8_t span_covers(
+    const cellspan_t span,
+    const uint32_t wx,
+    const uint32_t wy
+);
+
+/**
+ * Get the cell at (unwrapped) cell coordinates `cx`, `cy`.
+ */
+static spatialcell_t *cell_at(
+    spatial_t *const idx,
+    const int32_t cx,
+    const int32_t cy
+);
+
+/**
+ * Add entry `id` to `cell`. Returns 0 if there is an error.
+ */
+static uint8_t cell_add(
+    spatialcell_t *const cell,
+    const uint32_t id
+);
+
+/**
+ * Remove entry `id` from `cell`.
+ */
+static void cell_del(
+    spatialcell_t *const cell,
+    const uint32_t id
+);
+
+/**
+ * Start a new query, returning its stamp.
+ */
+static uint32_t next_stamp(
+    spatial_t *const idx
+);
+
+/**
+ * Returns 1 if rectangles `a` and `b` overlap.
+ */
+static uint8_t rects_overlap(
+    const rect_t a,
+    const rect_t b
+);
+
+/**
+ * Get the positions of the near and far edges of `rect` along axis `axis` (i.e. of its left and right, or top and bottom sides) into `out`.
+ */
+static void rect_edges(
+    const rect_t rect,
+    const spatialaxis_t axis,
+    int32_t *const out
+);
+
+/**
+ * Returns the index of the first edge in `list` ordered at or after position `pos` and reference `ref`.
+ */
+static uint32_t edges_search(
+    const spatialedgelist_t *const list,
+    const int32_t pos,
+    const uint32_t ref
+);
+
+/**
+ * Add the edge at position `pos` with reference `ref` to `list`. Returns 0 if there is an error.
+ */
+static uint8_t edges_add(
+    spatialedgelist_t *const list,
+    const int32_t pos,
+    const uint32_t ref
+);
+
+/**
+ * Remove the edge at position `pos` with reference `ref` from `list`, if it is there.
+ */
+static void edges_del(
+    spatialedgelist_t *const list,
+    const int32_t pos,
+    const uint32_t ref
+);
+
+/**
+ * Move the edge with reference `ref` from position `oldpos` to `newpos` in `list`. Only the edges between the two positions are shifted.
+ */
+static void edges_move(
+    spatialedgelist_t *const list,
+    const int32_t oldpos,
+    const int32_t newpos,
+    const uint32_t ref
+);
+
+/**
+ * Returns 1 if `edge` (along axis `axis`) belongs to an entry of the kinds in mask `kinds` other than object `exclude`, and overlaps the range from
+ * `lo` to `hi` on the other axis.
+ */
+static uint8_t edge_matches(
+    const spatial_t *const idx,
+    const spatialaxis_t axis,
+    const spatialedgeref_t edge,
+    const int32_t lo,
+    const int32_t hi,
+    const uint32_t kinds,
+    const void *const exclude
+);
+
+/**
+ * Add the edges of entry `id`, which has rectangle `rect`, to the index's edge lists. Returns 0 if there is an error.
+ */
+static uint8_t entry_edges_add(
+    spatial_t *const idx,
+    const uint32_t id,
+    const rect_t rect
+);
+
+/**
+ * Remove the edges of entry `id`, which has rectangle `rect`, from the index's edge lists.
+ */
+static void entry_edges_del(
+    spatial_t *const idx,
+    const uint32_t id,
+    const rect_t rect
+);
+
+spatial_t spatial_init(void) {
+    spatial_t idx;
+    memset(&idx, 0, sizeof(spatial_t));
+
+    idx.freehead = SPATIAL_ID_NONE;
+
+    idx.cells = calloc(SPATIAL_GRID_DIM * SPATIAL_GRID_DIM, sizeof(spatialcell_t));
+    if (!idx.cells) {
+        LERR("calloc() fault when initialising spatial index");
+    }
+
+    return idx;
+}
+
+void spatial_dealloc(spatial_t *const idx) {
+    if (idx->cells) {
+        for (uint32_t i = 0; i < SPATIAL_GRID_DIM * SPATIAL_GRID_DIM; i++) {
+            free(idx->cells[i].ids);
+        }
+        free(idx->cells);
+    }
+
+    free(idx->entries);
+
+    free(idx->edges[SPATIAL_AXIS_VERTICAL].edges);
+    free(idx->edges[SPATIAL_AXIS_HORIZONTAL].edges);
+
+    memset(idx, 0, sizeof(spatial_t));
+}
+
+uint32_t spatial_insert(spatial_t *const idx, const spatialkind_t kind, void *const data, const rect_t rect) {
+    if (!idx->cells) {
+        return SPATIAL_ID_NONE;
+    }
+
+    uint32_t id = idx->freehead;
+
+    if (id == SPATIAL_ID_NONE) {
+        // grow entries geometrically, putting the new entries on the free list
+        const uint32_t cap = (idx->entrycap) ? idx->entrycap << 1 : 32;
+
+        spatialentry_t *const entries = realloc(idx->entries, sizeof(spatialentry_t) * cap);
+        if (!entries) {
+            LERR("realloc() fault when growing spatial index");
+            return SPATIAL_ID_NONE;
+        }
+
+        for (uint32_t i = idx->entrycap; i < cap; i++) {
+            entries[i].used = 0;
+            entries[i].stamp = 0;
+            entries[i].nextfree = (i + 1 < cap) ? i + 1 : SPATIAL_ID_NONE;
+        }
+
+        idx->entries = entries;
+        id = idx->entrycap;
+        idx->entrycap = cap;
+    }
+
+    spatialentry_t *const entry = &idx->entries[id];
+    idx->freehead = entry->nextfree;
+
+    entry->rect = rect;
+    entry->data = data;
+    entry->kind = kind;
+    entry->used = 1;
+    entry->nextfree = SPATIAL_ID_NONE;
+
+    idx->len++;
+
+    const cellspan_t span = cell_span(rect);
+    for (int32_t cy = span.y0; cy <= span.y1; cy++) {
+        for (int32_t cx = span.x0; cx <= span.x1; cx++) {
+            if (!cell_add(cell_at(idx, cx, cy), id)) {
+                // undo partial insertion
+                spatial_remove(idx, id);
+                return SPATIAL_ID_NONE;
+            }
+        }
+    }
+
+    if (!entry_edges_add(idx, id, rect)) {
+        spatial_remove(idx, id);
+        return SPATIAL_ID_NONE;
+    }
+
+    return id;
+}
+
+void spatial_update(spatial_t *const idx, const uint32_t id, const rect_t rect) {
+    if (id >= idx->entrycap || !idx->entries[id].used) {
+        return;
+    }
+
+    spatialentry_t *const entry = &idx->entries[id];
+
+    // move whichever edges changed to their new place in the edge lists
+    for (uint32_t axis = SPATIAL_AXIS_VERTICAL; axis <= SPATIAL_AXIS_HORIZONTAL; axis++) {
+        int32_t oldedges[2], newedges[2];
+        rect_edges(entry->rect, axis, oldedges);
+        rect_edges(rect, axis, newedges);
+
+        for (uint32_t far = 0; far < 2; far++) {
+            if (oldedges[far] != newedges[far]) {
+                edges_move(&idx->edges[axis], oldedges[far], newedges[far], EDGE_REF(id, far));
+            }
+        }
+    }
+
+    const cellspan_t oldspan = cell_span(entry->rect);
+    const cellspan_t newspan = cell_span(rect);
+
+    entry->rect = rect;
+
+    if (memcmp(&oldspan, &newspan, sizeof(cellspan_t)) == 0) {
+        // still within the same cells
+        return;
+    }
+
+    // leave cells only covered by the old rectangle
+    for (int32_t cy = oldspan.y0; cy <= oldspan.y1; cy++) {
+        for (int32_t cx = oldspan.x0; cx <= oldspan.x1; cx++) {
+            if (!span_covers(newspan, cx & CELL_MASK, cy & CELL_MASK)) {
+                cell_del(cell_at(idx, cx, cy), id);
+            }
+        }
+    }
+
+    // enter cells only covered by the new rectangle
+    for (int32_t cy = newspan.y0; cy <= newspan.y1; cy++) {
+        for (int32_t cx = newspan.x0; cx <= newspan.x1; cx++) {
+            if (!span_covers(oldspan, cx & CELL_MASK, cy & CELL_MASK)) {
+                cell_add(cell_at(idx, cx, cy), id);
+            }
+        }
+    }
+}
+
+void spatial_remove(spatial_t *const idx, const uint32_t id) {
+    if (id >= idx->entrycap || !idx->entries[id].used) {
+        return;
+    }
+
+    spatialentry_t *const entry = &idx->entries[id];
+
+    const cellspan_t span = cell_span(entry->rect);
+    for (int32_t cy = span.y0; cy <= span.y1; cy++) {
+        for (int32_t cx = span.x0; cx <= span.x1; cx++) {
+            cell_del(cell_at(idx, cx, cy), id);
+        }
+    }
+
+    entry_edges_del(idx, id, entry->rect);
+
+    entry->used = 0;
+    entry->data = NULL;
+    entry->nextfree = idx->freehead;
+    idx->freehead = id;
+
+    idx->len--;
+}
+
+void spatial_clear(spatial_t *const idx, const uint32_t kinds) {
+    for (uint32_t id = 0; id < idx->entrycap; id++) {
+        if (idx->entries[id].used && (idx->entries[id].kind & kinds)) {
+            spatial_remove(idx, id);
+        }
+    }
+}
+
+uint32_t spatial_query_point(spatial_t *const idx, const offset_t p, const uint32_t kinds, void **const out, const uint32_t outn) {
+    if (!idx->cells) {
+        return 0;
+    }
+
+    const spatialcell_t *const cell = cell_at(idx, cell_coord(p.x), cell_coord(p.y));
+
+    // a point lies in a single cell, so entries can't be found twice
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < cell->len; i++) {
+        const spatialentry_t *const entry = &idx->entries[cell->ids[i]];
+        const rect_t r = entry->rect;
+
+        if (!(entry->kind & kinds)) {
+            continue;
+        }
+        if (p.x < r.offset.x || (int64_t)p.x >= (int64_t)r.offset.x + r.extent.width ||
+            p.y < r.offset.y || (int64_t)p.y >= (int64_t)r.offset.y + r.extent.height) {
+            continue;
+        }
+
+        if (n < outn) {
+            out[n] = entry->data;
+        }
+        n++;
+    }
+
+    return n;
+}
+
+uint32_t spatial_query_rect(spatial_t *const idx, const rect_t rect, const uint32_t kinds, void **const out, const uint32_t outn) {
+    if (!idx->cells) {
+        return 0;
+    }
+
+    const uint32_t stamp = next_stamp(idx);
+
+    uint32_t n = 0;
+
+    const cellspan_t span = cell_span(rect);
+    for (int32_t cy = span.y0; cy <= span.y1; cy++) {
+        for (int32_t cx = span.x0; cx <= span.x1; cx++) {
+            const spatialcell_t *const cell = cell_at(idx, cx, cy);
+
+            for (uint32_t i = 0; i < cell->len; i++) {
+                spatialentry_t *const entry = &idx->entries[cell->ids[i]];
+
+                if (entry->stamp == stamp) {
+                    continue;
+                }
+                entry->stamp = stamp;
+
+                if (!(entry->kind & kinds) || !rects_overlap(entry->rect, rect)) {
+                    continue;
+                }
+
+                if (n < outn) {
+                    out[n] = entry->data;
+                }
+                n++;
+            }
+        }
+    }
+
+    return n;
+}
+
+uint8_t spatial_nearest_edge(spatial_t *const idx, const offset_t p, const uint32_t maxdist, const uint32_t kinds, const void *const exclude,
+    spatialedge_t *const out)
+{
+    if (!idx->cells) {
+        return 0;
+    }
+
+    const uint32_t stamp = next_stamp(idx);
+
+    // an edge within reach lies in the square around `p`, grown by a pixel so the (exclusive) right and bottom edges are found too
+    const rect_t reach = {
+        .extent = { maxdist * 2 + 2, maxdist * 2 + 2 },
+        .offset = { p.x - (int32_t)maxdist - 1, p.y - (int32_t)maxdist - 1 }
+    };
+
+    uint8_t found = 0;
+    spatialedge_t best = { .dist = UINT32_MAX };
+
+    const cellspan_t span = cell_span(reach);
+    for (int32_t cy = span.y0; cy <= span.y1; cy++) {
+        for (int32_t cx = span.x0; cx <= span.x1; cx++) {
+            const spatialcell_t *const cell = cell_at(idx, cx, cy);
+
+            for (uint32_t i = 0; i < cell->len; i++) {
+                spatialentry_t *const entry = &idx->entries[cell->ids[i]];
+
+                if (entry->stamp == stamp) {
+                    continue;
+                }
+                entry->stamp = stamp;
+
+                if (!(entry->kind & kinds) || entry->data == exclude) {
+                    continue;
+                }
+
+                const rect_t r = entry->rect;
+                const int64_t x0 = r.offset.x, x1 = x0 + r.extent.width,
+                              y0 = r.offset.y, y1 = y0 + r.extent.height;
+
+                // distance past the ends of vertical and horizontal edges respectively
+                const int64_t pastv = (p.y < y0) ? y0 - p.y : ((p.y > y1) ? p.y - y1 : 0);
+                const int64_t pasth = (p.x < x0) ? x0 - p.x : ((p.x > x1) ? p.x - x1 : 0);
+
+                const struct {
+                    spatialside_t side;
+                    int64_t pos;
+                    int64_t perp;
+                    int64_t past;
+                } edges[] = {
+                    { SPATIAL_SIDE_LEFT,   x0, llabs(p.x - x0), pastv },
+                    { SPATIAL_SIDE_RIGHT,  x1, llabs(p.x - x1), pastv },
+                    { SPATIAL_SIDE_TOP,    y0, llabs(p.y - y0), pasth },
+                    { SPATIAL_SIDE_BOTTOM, y1, llabs(p.y - y1), pasth },
+                };
+
+                for (uint32_t e = 0; e < sizeof(edges) / sizeof(edges[0]); e++) {
+                    const int64_t dist = (edges[e].perp > edges[e].past) ? edges[e].perp : edges[e].past;
+
+                    if (dist > maxdist || dist >= best.dist) {
+                        continue;
+                    }
+
+                    best = (spatialedge_t){
+                        .data = entry->data,
+                        .kind = entry->kind,
+                        .side = edges[e].side,
+                        .pos = (int32_t)edges[e].pos,
+                        .dist = (uint32_t)dist
+                    };
+                    found = 1;
+                }
+            }
+        }
+    }
+
+    if (found) {
+        *out = best;
+    }
+
+    return found;
+}
+
+uint8_t spatial_nearest_line(spatial_t *const idx, const spatialaxis_t axis, const int32_t pos, const int32_t start, const int32_t end,
+    const uint32_t maxdist, const uint32_t kinds, const void *const exclude, spatialedge_t *const out)
+{
+    const spatialedgelist_t *const list = &idx->edges[axis];
+    const spatialedgeref_t *const edges = list->edges;
+
+    const int32_t lo = (start < end) ? start : end,
+                  hi = (start < end) ? end : start;
+
+    // the nearest edges on either side of `pos` are around where it would be inserted, so walk outwards from there in both directions until a
+    // matching edge (or an edge out of reach) is found
+    const uint32_t mid = edges_search(list, pos, 0);
+
+    uint32_t after = mid;
+    while (after < list->len && (int64_t)edges[after].pos - pos <= maxdist && !edge_matches(idx, axis, edges[after], lo, hi, kinds, exclude)) {
+        after++;
+    }
+    uint32_t before = mid;
+    while (before > 0 && (int64_t)pos - edges[before - 1].pos <= maxdist && !edge_matches(idx, axis, edges[before - 1], lo, hi, kinds, exclude)) {
+        before--;
+    }
+
+    const int64_t afterdist = (after < list->len) ? (int64_t)edges[after].pos - pos : INT64_MAX;
+    const int64_t beforedist = (before > 0) ? (int64_t)pos - edges[before - 1].pos : INT64_MAX;
+
+    if (afterdist > maxdist && beforedist > maxdist) {
+        return 0;
+    }
+
+    const spatialedgeref_t edge = (afterdist <= beforedist) ? edges[after] : edges[before - 1];
+    const spatialentry_t *const entry = &idx->entries[edge.ref >> 1];
+
+    *out = (spatialedge_t){
+        .data = entry->data,
+        .kind = entry->kind,
+        .side = (axis == SPATIAL_AXIS_VERTICAL) ?
+            ((edge.ref & 1) ? SPATIAL_SIDE_RIGHT : SPATIAL_SIDE_LEFT) :
+            ((edge.ref & 1) ? SPATIAL_SIDE_BOTTOM : SPATIAL_SIDE_TOP),
+        .pos = edge.pos,
+        .dist = (uint32_t)((afterdist <= beforedist) ? afterdist : beforedist)
+    };
+
+    return 1;
+}
+
+static int32_t cell_coord(const int32_t v) {
+    return (v >= 0) ? (v >> SPATIAL_CELL_SHIFT) : -((-(v + 1)) >> SPATIAL_CELL_SHIFT) - 1;
+}
+
+static cellspan_t cell_span(const rect_t rect) {
+    // empty rectangles are treated as covering a single pixel
+    const int64_t w = (rect.extent.width)  ? rect.extent.width  : 1;
+    const int64_t h = (rect.extent.height) ? rect.extent.height : 1;
+
+    const int64_t x1 = (int64_t)rect.offset.x + w - 1,
+                  y1 = (int64_t)rect.offset.y + h - 1;
+
+    cellspan_t span = {
+        .x0 = cell_coord(rect.offset.x),
+        .y0 = cell_coord(rect.offset.y),
+        .x1 = cell_coord((x1 > INT32_MAX) ? INT32_MAX : (int32_t)x1),
+        .y1 = cell_coord((y1 > INT32_MAX) ? INT32_MAX : (int32_t)y1),
+    };
+
+    // spans covering the whole grid would otherwise visit wrapped cells more than once
+    if (span.x1 - span.x0 >= SPATIAL_GRID_DIM) {
+        span.x1 = span.x0 + SPATIAL_GRID_DIM - 1;
+    }
+    if (span.y1 - span.y0 >= SPATIAL_GRID_DIM) {
+        span.y1 = span.y0 + SPATIAL_GRID_DIM - 1;
+    }
+
+    return span;
+}
+
+static uint8_t span_covers(const cellspan_t span, const uint32_t wx, const uint32_t wy) {
+    return ((wx - (uint32_t)span.x0) & CELL_MASK) <= (uint32_t)(span.x1 - span.x0)
+        && ((wy - (uint32_t)span.y0) & CELL_MASK) <= (uint32_t)(span.y1 - span.y0);
+}
+
+static spatialcell_t *cell_at(spatial_t *const idx, const int32_t cx, const int32_t cy) {
+    return &idx->cells[((uint32_t)cy & CELL_MASK) * SPATIAL_GRID_DIM + ((uint32_t)cx & CELL_MASK)];
+}
+
+static uint8_t cell_add(spatialcell_t *const cell, const uint32_t id) {
+    if (cell->len >= cell->cap) {
+        const uint32_t cap = (cell->cap) ? cell->cap << 1 : 4;
+
+        uint32_t *const ids = realloc(cell->ids, sizeof(uint32_t) * cap);
+        if (!ids) {
+            LERR("realloc() fault when growing spatial index cell");
+            return 0;
+        }
+
+        cell->ids = ids;
+        cell->cap = cap;
+    }
+
+    cell->ids[cell->len++] = id;
+
+    return 1;
+}
+
+static void cell_del(spatialcell_t *const cell, const uint32_t id) {
+    for (uint32_t i = 0; i < cell->len; i++) {
+        if (cell->ids[i] == id) {
+            // order within a cell doesn't matter
+            cell->ids[i] = cell->ids[--cell->len];
+            return;
+        }
+    }
+}
+
+static uint32_t next_stamp(spatial_t *const idx) {
+    if (++idx->stamp == 0) {
+        // stamps wrapped around, so forget old ones so they can't be mistaken for the new stamp
+        for (uint32_t i = 0; i < idx->entrycap; i++) {
+            idx->entries[i].stamp = 0;
+        }
+        idx->stamp = 1;
+    }
+
+    return idx->stamp;
+}
+
+static uint8_t rects_overlap(const rect_t a, const rect_t b) {
+    const int64_t aw = (a.extent.width)  ? a.extent.width  : 1, ah = (a.extent.height) ? a.extent.height : 1;
+    const int64_t bw = (b.extent.width)  ? b.extent.width  : 1, bh = (b.extent.height) ? b.extent.height : 1;
+
+    return a.offset.x < b.offset.x + bw && b.offset.x < a.offset.x + aw
+        && a.offset.y < b.offset.y + bh && b.offset.y < a.offset.y + ah;
+}
+
+static void rect_edges(const rect_t rect, const spatialaxis_t axis, int32_t *const out) {
+    const int32_t near = (axis == SPATIAL_AXIS_VERTICAL) ? rect.offset.x : rect.offset.y;
+    const int64_t far = (int64_t)near + ((axis == SPATIAL_AXIS_VERTICAL) ? rect.extent.width : rect.extent.height);
+
+    out[0] = near;
+    out[1] = (far > INT32_MAX) ? INT32_MAX : (int32_t)far;
+}
+
+static uint32_t edges_search(const spatialedgelist_t *const list, const int32_t pos, const uint32_t ref) {
+    uint32_t lo = 0, hi = list->len;
+
+    while (lo < hi) {
+        const uint32_t mid = lo + (hi - lo) / 2;
+        const spatialedgeref_t edge = list->edges[mid];
+
+        if (edge.pos < pos || (edge.pos == pos && edge.ref < ref)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+static uint8_t edges_add(spatialedgelist_t *const list, const int32_t pos, const uint32_t ref) {
+    if (list->len >= list->cap) {
+        const uint32_t cap = (list->cap) ? list->cap << 1 : 64;
+
+        spatialedgeref_t *const edges = realloc(list->edges, sizeof(spatialedgeref_t) * cap);
+        if (!edges) {
+            LERR("realloc() fault when growing spatial index edge list");
+            return 0;
+        }
+
+        list->edges = edges;
+        list->cap = cap;
+    }
+
+    const uint32_t i = edges_search(list, pos, ref);
+
+    memmove(&list->edges[i + 1], &list->edges[i], sizeof(spatialedgeref_t) * (list->len - i));
+    list->edges[i] = (spatialedgeref_t){ pos, ref };
+    list->len++;
+
+    return 1;
+}
+
+static void edges_del(spatialedgelist_t *const list, const int32_t pos, const uint32_t ref) {
+    const uint32_t i = edges_search(list, pos, ref);
+    if (i >= list->len || list->edges[i].pos != pos || list->edges[i].ref != ref) {
+        return;
+    }
+
+    list->len--;
+    memmove(&list->edges[i], &list->edges[i + 1], sizeof(spatialedgeref_t) * (list->len - i));
+}
+
+static void edges_move(spatialedgelist_t *const list, const int32_t oldpos, const int32_t newpos, const uint32_t ref) {
+    const uint32_t i = edges_search(list, oldpos, ref);
+    if (i >= list->len || list->edges[i].pos != oldpos || list->edges[i].ref != ref) {
+        return;
+    }
+
+    // (the search for the new place still sees the edge at its old place, which is before it if it is moving forward)
+    uint32_t j = edges_search(list, newpos, ref);
+
+    if (j > i) {
+        j--;
+        memmove(&list->edges[i], &list->edges[i + 1], sizeof(spatialedgeref_t) * (j - i));
+    } else if (j < i) {
+        memmove(&list->edges[j + 1], &list->edges[j], sizeof(spatialedgeref_t) * (i - j));
+    }
+
+    list->edges[j] = (spatialedgeref_t){ newpos, ref };
+}
+
+static uint8_t edge_matches(const spatial_t *const idx, const spatialaxis_t axis, const spatialedgeref_t edge, const int32_t lo, const int32_t hi,
+    const uint32_t kinds, const void *const exclude)
+{
+    const spatialentry_t *const entry = &idx->entries[edge.ref >> 1];
+
+    if (!(entry->kind & kinds) || entry->data == exclude) {
+        return 0;
+    }
+
+    int32_t span[2];
+    rect_edges(entry->rect, (axis == SPATIAL_AXIS_VERTICAL) ? SPATIAL_AXIS_HORIZONTAL : SPATIAL_AXIS_VERTICAL, span);
+
+    return span[0] <= hi && lo <= span[1];
+}
+
+static uint8_t entry_edges_add(spatial_t *const idx, const uint32_t id, const rect_t rect) {
+    for (uint32_t axis = SPATIAL_AXIS_VERTICAL; axis <= SPATIAL_AXIS_HORIZONTAL; axis++) {
+        int32_t edges[2];
+        rect_edges(rect, axis, edges);
+
+        for (uint32_t far = 0; far < 2; far++) {
+            if (!edges_add(&idx->edges[axis], edges[far], EDGE_REF(id, far))) {
+                // edges already added are removed along with the entry
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+static void entry_edges_del(spatial_t *const idx, const uint32_t id, const rect_t rect) {
+    for (uint32_t axis = SPATIAL_AXIS_VERTICAL; axis <= SPATIAL_AXIS_HORIZONTAL; axis++) {
+        int32_t edges[2];
+        rect_edges(rect, axis, edges);
+
+        for (uint32_t far = 0; far < 2; far++) {
+            edges_del(&idx->edges[axis], edges[far], EDGE_REF(id, far));
+        }
+    }
+}
@@ -0,0 +1,252 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#pragma once
+#ifndef __awm__spatial_h
+#define __awm__spatial_h
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include "data/rect.h"
+
+#include <stdint.h>
+
+/**
+ * Width and height of a grid cell, as a power of two (i.e. cells are 128x128 pixels).
+ */
+#define SPATIAL_CELL_SHIFT 7
+/**
+ * Amount of grid cells along each axis (a power of two). Cell coordinates wrap around, so the grid covers an unbounded plane.
+ */
+#define SPATIAL_GRID_DIM 64
+
+/**
+ * Entry id signifying no entry.
+ */
+#define SPATIAL_ID_NONE UINT32_MAX
+
+/**
+ * Kinds of rectangles stored in a spatial index, as bits so they can be combined into masks for queries.
+ */
+typedef enum spatialkind_t {
+    SPATIAL_KIND_CLIENT =   1 << 0,
+    SPATIAL_KIND_MONITOR =  1 << 1,
+
+    /** Mask matching all kinds */
+    SPATIAL_KIND_ALL =      SPATIAL_KIND_CLIENT | SPATIAL_KIND_MONITOR
+} spatialkind_t;
+
+/**
+ * Sides of a rectangle, as returned in edge queries.
+ */
+typedef enum spatialside_t {
+    SPATIAL_SIDE_LEFT = 0,
+    SPATIAL_SIDE_RIGHT,
+    SPATIAL_SIDE_TOP,
+    SPATIAL_SIDE_BOTTOM,
+} spatialside_t;
+
+/**
+ * Axes along which the edges of indexed rectangles lie. Vertical edges (left and right sides) are positioned by x, horizontal edges (top and
+ * bottom sides) by y.
+ */
+typedef enum spatialaxis_t {
+    SPATIAL_AXIS_VERTICAL = 0,
+    SPATIAL_AXIS_HORIZONTAL,
+} spatialaxis_t;
+
+/**
+ * An edge in one of a spatial index's sorted edge lists.
+ */
+typedef struct spatialedgeref_t {
+    /** Position of the edge along its perpendicular axis */
+    int32_t pos;
+    /** Id of the entry the edge belongs to, shifted left by one; the low bit is set for right and bottom edges */
+    uint32_t ref;
+} spatialedgeref_t;
+
+/**
+ * The edges of every entry along one axis, sorted by position (then by reference, so each edge has a unique place in the list).
+ */
+typedef struct spatialedgelist_t {
+    spatialedgeref_t *edges;
+    uint32_t len;
+    uint32_t cap;
+} spatialedgelist_t;
+
+/**
+ * A rectangle stored in a spatial index.
+ */
+typedef struct spatialentry_t {
+    /** Indexed rectangle */
+    rect_t rect;
+    /** Object the rectangle belongs to (e.g. a `client_t *` or `monitor_t *`, depending on `kind`) */
+    void *data;
+    /** Kind of object */
+    spatialkind_t kind;
+    /** Query stamp, used to only report entries spanning multiple cells once per query */
+    uint32_t stamp;
+    /** Next free entry, if this entry is not in use */
+    uint32_t nextfree;
+    /** 1 if the entry is in use */
+    uint8_t used;
+} spatialentry_t;
+
+/**
+ * A grid cell, listing the ids of entries overlapping it (or overlapping a cell that wraps onto it).
+ */
+typedef struct spatialcell_t {
+    uint32_t *ids;
+    uint32_t len;
+    uint32_t cap;
+} spatialcell_t;
+
+/**
+ * A spatial index over rectangles (i.e. client frames and monitors), stored in a uniform grid whose cells wrap around.
+ */
+typedef struct spatial_t {
+    /** Entries, indexed by id */
+    spatialentry_t *entries;
+    /** Capacity of `entries` */
+    uint32_t entrycap;
+    /** Head of the free entry list, or `SPATIAL_ID_NONE` */
+    uint32_t freehead;
+    /** Amount of entries in use */
+    uint32_t len;
+
+    /** Grid cells (`SPATIAL_GRID_DIM` * `SPATIAL_GRID_DIM` of them, row-major) */
+    spatialcell_t *cells;
+
+    /** Stamp of the most recent query */
+    uint32_t stamp;
+
+    /** Edges of every entry, indexed by axis, kept sorted as entries are inserted, moved and removed */
+    spatialedgelist_t edges[2];
+} spatial_t;
+
+/**
+ * A result of a nearest-edge query.
+ */
+typedef struct spatialedge_t {
+    /** Object the edge belongs to */
+    void *data;
+    /** Kind of object */
+    spatialkind_t kind;
+    /** Side of the object's rectangle */
+    spatialside_t side;
+    /** Position of the edge along its perpendicular axis (x for left and right edges, y for top and bottom edges) */
+    int32_t pos;
+    /** Distance from the queried point to the edge */
+    uint32_t dist;
+} spatialedge_t;
+
+/**
+ * Initialise an empty spatial index.
+ */
+spatial_t spatial_init(void);
+
+/**
+ * Free memory allocated for the given spatial index.
+ */
+void spatial_dealloc(
+    spatial_t *const idx
+);
+
+/**
+ * Add rectangle `rect` for object `data` of kind `kind` to the index. Returns the id of the new entry, or `SPATIAL_ID_NONE` if there is an error.
+ */
+uint32_t spatial_insert(
+    spatial_t *const idx,
+    const spatialkind_t kind,
+    void *const data,
+    const rect_t rect
+);
+
+/**
+ * Update the rectangle of entry `id`. Only the cells the entry enters or leaves are touched.
+ */
+void spatial_update(
+    spatial_t *const idx,
+    const uint32_t id,
+    const rect_t rect
+);
+
+/**
+ * Remove entry `id` from the index.
+ */
+void spatial_remove(
+    spatial_t *const idx,
+    const uint32_t id
+);
+
+/**
+ * Remove all entries of the kinds in mask `kinds` from the index.
+ */
+void spatial_clear(
+    spatial_t *const idx,
+    const uint32_t kinds
+);
+
+/**
+ * Find entries of the kinds in mask `kinds` containing point `p`. Up to `outn` matching objects are written to `out`; the total amount of matches
+ * is returned.
+ */
+uint32_t spatial_query_point(
+    spatial_t *const idx,
+    const offset_t p,
+    const uint32_t kinds,
+    void **const out,
+    const uint32_t outn
+);
+
+/**
+ * Find entries of the kinds in mask `kinds` overlapping rectangle `rect`. Up to `outn` matching objects are written to `out`; the total amount of
+ * matches is returned.
+ */
+uint32_t spatial_query_rect(
+    spatial_t *const idx,
+    const rect_t rect,
+    const uint32_t kinds,
+    void **const out,
+    const uint32_t outn
+);
+
+/**
+ * Find the edge of an entry (of the kinds in mask `kinds`, ignoring object `exclude`) nearest to point `p`, no further than `maxdist` away.
+ * The distance to an edge is the larger of the distance to its line and the distance past either of its ends. Returns 0 if there is no such edge.
+ */
+uint8_t spatial_nearest_edge(
+    spatial_t *const idx,
+    const offset_t p,
+    const uint32_t maxdist,
+    const uint32_t kinds,
+    const void *const exclude,
+    spatialedge_t *const out
+);
+
+/**
+ * Find the edge along axis `axis` (of an entry of the kinds in mask `kinds`, ignoring object `exclude`) nearest to position `pos`, no further than
+ * `maxdist` away, and overlapping the range from `start` to `end` on the other axis. This is a binary search of the sorted edge list for the axis,
+ * so it doesn't depend on the amount of entries far from `pos`. Returns 0 if there is no such edge.
+ */
+uint8_t spatial_nearest_line(
+    spatial_t *const idx,
+    const spatialaxis_t axis,
+    const int32_t pos,
+    const int32_t start,
+    const int32_t end,
+    const uint32_t maxdist,
+    const uint32_t kinds,
+    const void *const exclude,
+    spatialedge_t *const out
+);
+
+#ifdef __cplusplus
+    }
+#endif
+#endif
@@ -0,0 +1,244 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#include "stack.h"
+
+#include "manager/client/client.h"
+#include "manager/atoms.h"
+#include "manager/session.h"
+#include "util/logging.h"
+
+#include <string.h>
+
+/**
+ * Link `client` at the top of layer `layer` of the stacking list.
+ */
+static void link_top(
+    clientstack_t *const stack,
+    client_t *const client,
+    const stacklayer_t layer
+);
+
+/**
+ * Unlink `client` from the stacking list.
+ */
+static void unlink_client(
+    clientstack_t *const stack,
+    client_t *const client
+);
+
+/**
+ * Returns 1 if all layers above `layer` are empty.
+ */
+static uint8_t layers_above_empty(
+    const clientstack_t *const stack,
+    const stacklayer_t layer
+);
+
+/**
+ * Restack the frame of `client` to the top of its layer, i.e. directly below the layer's sentinel.
+ */
+static void restack_frame(
+    session_t *const session,
+    client_t *const client
+);
+
+clientstack_t stack_init(xcb_connection_t *const con, xcb_screen_t *const scr) {
+    clientstack_t stack;
+
+    memset(&stack, 0, sizeof(clientstack_t));
+
+    // new windows are created at the top of the stack, so creating sentinels in layer order stacks them in that order
+    for (uint32_t i = 0; i < STACK_LAYER_COUNT; i++) {
+        const xcb_window_t sentinel = xcb_generate_id(con);
+
+        xcb_create_window(con, 0, sentinel, scr->root,
+            -1, -1, 1, 1,
+            0,
+            XCB_WINDOW_CLASS_INPUT_ONLY, XCB_COPY_FROM_PARENT,
+            XCB_CW_OVERRIDE_REDIRECT,
+            (uint32_t []) { 1 });
+
+        stack.sentinels[i] = sentinel;
+    }
+
+    // replace any list left over from a previous window manager
+    stack.publish = STACK_PUBLISH_REPLACE;
+
+    return stack;
+}
+
+void stack_dealloc(clientstack_t *const stack) {
+    free(stack->buf);
+
+    memset(stack, 0, sizeof(clientstack_t));
+}
+
+void stack_push(session_t *const session, client_t *const client, const stacklayer_t layer) {
+    clientstack_t *const stack = &session->stack;
+
+    if (client->stack.linked) {
+        stack_set_layer(session, client, layer);
+        return;
+    }
+
+    link_top(stack, client, layer);
+    stack->len++;
+
+    restack_frame(session, client);
+
+    // clients added above everything else are appended to the published list; anything else changes the order
+    if (stack->publish != STACK_PUBLISH_REPLACE && layers_above_empty(stack, layer)) {
+        stack->publish = STACK_PUBLISH_APPEND;
+        stack->appendn++;
+    } else {
+        stack->publish = STACK_PUBLISH_REPLACE;
+    }
+}
+
+void stack_remove(session_t *const session, client_t *const client) {
+    clientstack_t *const stack = &session->stack;
+
+    if (!client->stack.linked) {
+        return;
+    }
+
+    unlink_client(stack, client);
+    stack->len--;
+
+    stack->publish = STACK_PUBLISH_REPLACE;
+}
+
+void stack_raise(session_t *const session, client_t *const client) {
+    stack_set_layer(session, client, client->stack.layer);
+}
+
+void stack_set_layer(session_t *const session, client_t *const client, const stacklayer_t layer) {
+    clientstack_t *const stack = &session->stack;
+
+    if (!client->stack.linked) {
+        stack_push(session, client, layer);
+        return;
+    }
+
+    // redundant restack
+    if (client->stack.layer == layer && stack->top[layer] == client) {
+        session->evstats.restack_skipped++;
+        return;
+    }
+
+    unlink_client(stack, client);
+    link_top(stack, client, layer);
+
+    restack_frame(session, client);
+
+    stack->publish = STACK_PUBLISH_REPLACE;
+}
+
+void stack_publish(session_t *const session) {
+    xcb_connection_t *const con = session->con;
+    clientstack_t *const stack = &session->stack;
+
+    if (stack->publish == STACK_PUBLISH_CLEAN) {
+        return;
+    }
+
+    // grow scratch buffer geometrically
+    if (stack->bufcap < stack->len) {
+        uint32_t cap = (stack->bufcap) ? stack->bufcap : 16;
+        while (cap < stack->len) {
+            cap <<= 1;
+        }
+
+        xcb_window_t *const buf = realloc(stack->buf, sizeof(xcb_window_t) * cap);
+        if (!buf) {
+            LERR("realloc() fault when publishing stacking order");
+            return;
+        }
+        stack->buf = buf;
+        stack->bufcap = cap;
+    }
+
+    // list clients from bottom to top
+    uint32_t n = 0;
+    for (uint32_t l = 0; l < STACK_LAYER_COUNT; l++) {
+        for (client_t *c = stack->bottom[l]; c; c = c->stack.above) {
+            stack->buf[n++] = c->inner;
+        }
+    }
+
+    if (stack->publish == STACK_PUBLISH_APPEND && stack->appendn <= n) {
+        xcb_change_property(con, XCB_PROP_MODE_APPEND, session->root, ATOMS__NET_CLIENT_LIST_STACKING, XCB_ATOM_WINDOW, 32,
+            stack->appendn, stack->buf + (n - stack->appendn));
+    } else {
+        xcb_change_property(con, XCB_PROP_MODE_REPLACE, session->root, ATOMS__NET_CLIENT_LIST_STACKING, XCB_ATOM_WINDOW, 32,
+            n, stack->buf);
+    }
+    session_defer_flush(session);
+
+    stack->publish = STACK_PUBLISH_CLEAN;
+    stack->appendn = 0;
+}
+
+static void link_top(clientstack_t *const stack, client_t *const client, const stacklayer_t layer) {
+    stacknode_t *const node = &client->stack;
+
+    node->layer = layer;
+    node->below = stack->top[layer];
+    node->above = NULL;
+    node->linked = 1;
+
+    if (stack->top[layer]) {
+        stack->top[layer]->stack.above = client;
+    } else {
+        stack->bottom[layer] = client;
+    }
+    stack->top[layer] = client;
+}
+
+static void unlink_client(clientstack_t *const stack, client_t *const client) {
+    stacknode_t *const node = &client->stack;
+    const stacklayer_t layer = node->layer;
+
+    if (node->below) {
+        node->below->stack.above = node->above;
+    } else {
+        stack->bottom[layer] = node->above;
+    }
+    if (node->above) {
+        node->above->stack.below = node->below;
+    } else {
+        stack->top[layer] = node->below;
+    }
+
+    node->below = NULL;
+    node->above = NULL;
+    node->linked = 0;
+}
+
+static uint8_t layers_above_empty(const clientstack_t *const stack, const stacklayer_t layer) {
+    for (uint32_t l = layer + 1; l < STACK_LAYER_COUNT; l++) {
+        if (stack->bottom[l]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void restack_frame(session_t *const session, client_t *const client) {
+    xcb_connection_t *const con = session->con;
+
+    xcb_configure_window(con, client->frame,
+        XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE,
+        (uint32_t []) {
+            session->stack.sentinels[client->stack.layer],
+            XCB_STACK_MODE_BELOW
+        });
+
+    session_defer_flush(session);
+}
@@ -0,0 +1,146 @@
+/*
+ *   Copyright (c) 2024 Jack Bennett.
+ *   All Rights Reserved.
+ *
+ *   See the LICENCE file for more information.
+ */
+
+#pragma once
+#ifndef __awm__stack_h
+#define __awm__stack_h
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+#include <xcb/xcb.h>
+
+typedef struct client_t client_t;
+typedef struct session_t session_t;
+
+/**
+ * Stacking layers of clients, from bottom to top. A client is always stacked above every client in lower layers.
+ */
+typedef enum stacklayer_t {
+    STACK_LAYER_DESKTOP = 0,
+    STACK_LAYER_BELOW,
+    STACK_LAYER_NORMAL,
+    STACK_LAYER_ABOVE,
+    STACK_LAYER_DOCK,
+    STACK_LAYER_FULLSCREEN,
+
+    /** Amount of stacking layers */
+    STACK_LAYER_COUNT
+} stacklayer_t;
+
+/**
+ * Links of a client in the stacking list.
+ */
+typedef struct stacknode_t {
+    /** Next client down within the same layer, or NULL if bottom of the layer */
+    client_t *below;
+    /** Next client up within the same layer, or NULL if top of the layer */
+    client_t *above;
+    /** Layer the client is in */
+    stacklayer_t layer;
+    /** 1 if the client is in the stacking list */
+    uint8_t linked;
+} stacknode_t;
+
+/**
+ * State of the published _NET_CLIENT_LIST_STACKING property.
+ */
+typedef enum stackpublish_t {
+    /** The property is up to date */
+    STACK_PUBLISH_CLEAN = 0,
+    /** Clients have only been added on top of everything since the last update, so they can be appended to the property */
+    STACK_PUBLISH_APPEND,
+    /** The order has changed, so the property must be replaced */
+    STACK_PUBLISH_REPLACE,
+} stackpublish_t;
+
+/**
+ * The window manager's model of the client stacking order.
+ *
+ * Each layer is bounded above by a sentinel window (unmapped and InputOnly) - sentinels are stacked in layer order, so a client can be placed at
+ * the top of its layer with a single sibling-relative ConfigureWindow request, without needing to know about any other clients.
+ */
+typedef struct clientstack_t {
+    /** Sentinel windows, marking the top of each layer */
+    xcb_window_t sentinels[STACK_LAYER_COUNT];
+    /** Bottom-most client of each layer */
+    client_t *bottom[STACK_LAYER_COUNT];
+    /** Top-most client of each layer */
+    client_t *top[STACK_LAYER_COUNT];
+    /** Amount of clients in the stack */
+    uint32_t len;
+
+    /** State of the _NET_CLIENT_LIST_STACKING property */
+    stackpublish_t publish;
+    /** Amount of clients to append to the property, if `publish` is `STACK_PUBLISH_APPEND` */
+    uint32_t appendn;
+    /** Scratch buffer for building the property */
+    xcb_window_t *buf;
+    /** Capacity of `buf` */
+    uint32_t bufcap;
+} clientstack_t;
+
+/**
+ * Initialise a stacking model, creating its sentinel windows under the root window of screen `scr`.
+ */
+clientstack_t stack_init(
+    xcb_connection_t *const con,
+    xcb_screen_t *const scr
+);
+
+/**
+ * Free memory allocated for the given stacking model.
+ */
+void stack_dealloc(
+    clientstack_t *const stack
+);
+
+/**
+ * Add `client` to the top of layer `layer` of the session's stack.
+ */
+void stack_push(
+    session_t *const session,
+    client_t *const client,
+    const stacklayer_t layer
+);
+
+/**
+ * Remove `client` from the session's stack.
+ */
+void stack_remove(
+    session_t *const session,
+    client_t *const client
+);
+
+/**
+ * Raise `client` to the top of its layer. Nothing is sent to the X server if it is already there.
+ */
+void stack_raise(
+    session_t *const session,
+    client_t *const client
+);
+
+/**
+ * Move `client` to the top of layer `layer`. Nothing is sent to the X server if it is already there.
+ */
+void stack_set_layer(
+    session_t *const session,
+    client_t *const client,
+    const stacklayer_t layer
+);
+
+/**
+ * Update _NET_CLIENT_LIST_STACKING on the root window if the stacking order has changed since it was last updated.
+ */
+void stack_publish(
+    session_t *const session
+);
+
+#ifdef __cplusplus
+    }
+#endif
+#endif
@@ -7,6 +7,8 @@
 
 #include "genutil.h"
 
+#include <time.h>
+
 int32_t min(int32_t a, int32_t b) {
     return (a < b) ? a : b;
 }
@@ -18,3 +20,10 @@ int32_t max(int32_t a, int32_t b) {
 int32_t rndto(int32_t v, int32_t m) {
     return v + (m - v) % m;
 }
+
+uint64_t monotime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
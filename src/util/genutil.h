@@ -38,6 +38,11 @@ int32_t rndto(
     int32_t m
 );
 
+/**
+ * Return the current time of the monotonic clock, in nanoseconds
+ */
+uint64_t monotime_ns(void);
+
 #ifdef __cplusplus
     }
 #endif